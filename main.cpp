@@ -3,12 +3,46 @@
 //  this program implements the tomasulo algorithm
 //  the assumed variables are listed at the beginning of the main function
 //  they may be configured, as necessary
+//  usage: ./main [trace file...]
+//         ./main -d [trace file]
+//  each trace file given on the command line is simulated in turn (batch mode),
+//  if none are given the default filename from the assumptions is used
+//         ./main -q [trace file...]
+//         ./main -a [trace file...]
+//         ./main -t <rr|icount> [trace file...]
+//         ./main -f [trace file...]
+//         ./main -s [trace file...]
+//  -d runs the trace in an interactive debugger instead of printing every cycle
+//  (type help at the prompt for its commands)
+//  -q only prints the last cycle of each trace
+//  -a analyzes each run once it has finished: the critical path is rebuilt from the cycles each
+//  instruction issued, completed and was written in and the producers it waited for, and every
+//  cycle of it is charged to a cause (issue, true dependence, fu latency, full station or free
+//  list, cdb conflict), which are printed ranked along with the resources and instructions
+//  they were charged to
+//  -t runs the trace files together as the threads of one simultaneously multithreaded run:
+//  they share the reservation stations, the cdb and the physical registers, and each has its own
+//  rename map. one instruction issues per cycle, from the first thread that can issue, with the
+//  threads tried in round robin order (rr) or fewest instructions in flight first (icount).
+//  the instructions per cycle of each thread and of the whole run are printed at the end
+//  -f runs traces on an engine specialized for the station counts, latencies and register file
+//  sizes in the assumptions (fixed_machine in main), rather than reading them from the
+//  machine_config every cycle - the results are the same
+//  -s runs like -q, and prints how many cycles were simulated per second (not counting reading
+//  the trace or printing)
 //  the expected format of the input text file is as follows:
 //  <instruction type> <store register> <register j (value if load)> <register k>
 //  <instruction types>: LD, SD, MULTD, DIVD, ADDD, SUBD
+//  vector instruction types: VLD, VST, VMULTD, VDIVD, VADDD, VSUBD, which take the same operands
+//  but name vector registers [V0, Vn] (numbered consecutively, configured in assumptions),
+//  VLD sets every element of the register to the value
+//  a line "VL <n>" sets the vector length (1 to maxVectorLength) of the vector instructions that follow it
+//  a vector instruction takes the latency of its scalar form plus one cycle for every further
+//  group of vectorLanes elements, and consumers are chained: the first elements of a result are
+//  sent over the cdb, after which waiting vector instructions start, finishing no sooner than the
+//  whole vector is written
 //  <store register>: [R0, Rn] where n is the number of registers (configured in assumptions)
-//  Note: the program takes advantage of strncmp with 2 characters to find the correct register,
-//  so if the number of registers is too large, the program may not execute correctly
+//  Note: registers are named by even numbers (R0, R2, R4, etc.), so register Rn is stored at index n/2
 //  <register j>: same as <store register> or int if load
 //  <register k>: same as <store register>
 //  Note that for simplicity, and ability to verify correct output,
@@ -18,6 +52,16 @@
 //  rather than a source register, offset and register to calculate the memory address to store the value in
 //  also for simplicity "memory" and "registers" are maintained in the same place,
 //  and therefore have the same names [R0, R2, etc.]
+//  registers are renamed explicitly: every destination (including the register written by a store)
+//  is given a physical register from the free list, and the rename map points each architectural
+//  register at its current physical register. issue stalls when the free list is empty, so
+//  numPhysRegisters limits the number of values in flight independently of the station counts.
+//  a physical register returns to the free list once it has been written and remapped.
+//  numPhysRegisters >= numRegisters (times the number of threads) + the total number of stations
+//  never stalls.
+//  instructions are decoded once, when the file is read, into a compact record
+//  (opcode and register indices), and all per-run state is carved out of a single arena
+//  which is reset (not freed) between runs
 //
 //  Created by Tess Gauthier on 2/24/19.
 //  Copyright © 2019 Tess Gauthier. All rights reserved.
@@ -27,709 +71,2484 @@
 #include <iomanip>
 #include <cmath>
 #include <fstream>
+#include <new>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 #define MAXCHAR 1000
+#define ARENA_BYTES 65536
+#define MAX_BREAKPOINTS 32
+#define MAX_SNAPSHOTS 64
+#define MAX_HOT_INSTRUCTIONS 10
 
 using namespace std;
 
-typedef struct instruction
-{
-    char type[100];
-    char dest_reg[100];
-    char reg_j[100];
-    char reg_k[100];
-    double num;
-    double rs=0;
-    double issue=-1;
-    double completion=-1;
-    double written=-1;
-    int result;
+enum opcode
+{
+    OP_NONE=0,
+    OP_LD,
+    OP_SD,
+    OP_ADDD,
+    OP_SUBD,
+    OP_MULTD,
+    OP_DIVD,
+    OP_VLD,
+    OP_VST,
+    OP_VADDD,
+    OP_VSUBD,
+    OP_VMULTD,
+    OP_VDIVD
+};
+
+const char* opcode_names[] = {"NONE", "LD", "SD", "ADDD", "SUBD", "MULTD", "DIVD",
+    "VLD", "VST", "VADDD", "VSUBD", "VMULTD", "VDIVD"};
+const int numOpcodes = 13;
+
+// resources that can hold up issue
+enum stall_class
+{
+    STALL_NONE=0,
+    STALL_ADD,
+    STALL_MUL,
+    STALL_LOAD,
+    STALL_STORE,
+    STALL_REGS,
+    STALL_ANY
+};
+
+const char* stall_names[] = {"none", "add", "mul", "load", "store", "regs", "any"};
+const int numStallClasses = 7;
+
+// order in which threads get the chance to issue each cycle
+enum fetch_policy
+{
+    FETCH_RR=0,     // round robin - the first choice rotates every cycle
+    FETCH_ICOUNT    // fewest instructions in flight first, ties broken round robin
+};
+
+const char* fetch_policy_names[] = {"rr", "icount"};
+const int numFetchPolicies = 2;
+
+// what each cycle of the critical path was spent on
+enum path_cause
+{
+    CAUSE_ISSUE=0,      // in-order issue, one instruction per cycle (and slots taken by other threads)
+    CAUSE_DEPENDENCE,   // waiting in a station for a producer's result
+    CAUSE_LATENCY,      // executing, and the write that ends it
+    CAUSE_STATION,      // issue held up by a full station
+    CAUSE_REGS,         // issue held up by an empty free list
+    CAUSE_CDB           // completed, waiting for the cdb
+};
+
+const char* path_cause_names[] = {"issue", "dependence", "fu latency", "station full", "regs full", "cdb conflict"};
+const int numPathCauses = 6;
+
+// resources critical path cycles are charged to - the add/mul/load/store units and stations,
+// and the free list, are numbered as their stall class
+const char* resource_names[] = {"issue", "add", "mul", "load", "store", "regs", "cdb"};
+const int numResources = 7;
+const int RESOURCE_CDB = 6;
+
+// decoded instruction - registers are stored as architectural register indices,
+// with vector register n at index numRegisters + n
+typedef struct decoded_instruction
+{
+    unsigned char op=OP_NONE;
+    signed char dest=-1;
+    signed char reg_j=-1;
+    signed char reg_k=-1;
+    unsigned char vl=0;
     int load=0;
-    bool completing=false;
-    bool writing=false;
-} instruction;
+} decoded_instruction;
+
+// just for bookkeeping - cycle numbers of each instruction, and what it waited for (for the
+// critical path analysis)
+typedef struct instruction_status
+{
+    int rs=0;
+    int issue=-1;
+    int completion=-1;
+    int written=-1;
+    int producer_j=-1;  // instructions whose results it was waiting for when it issued
+    int producer_k=-1;
+    int stall=STALL_NONE;   // what last held up its issue
+    int freed=-1;           // and the instruction whose write let it issue
+} instruction_status;
+
+typedef struct physical_register
+{
+    double data=0;
+    int producer=0;     // station that will write the value, for printing
+    int readers=0;      // vector stations that still have to read it
+    bool ready=true;
+    bool mapped=false;
+} physical_register;
+
+typedef struct reservation_station
+{
+    double data_j=0;
+    double data_k=0;
+    int num;
+    int dest_tag=0;
+    int tag_j=0;
+    int tag_k=0;
+    int src_j=-1;       // vector sources are read from the physical register when the result is computed
+    int src_k=-1;
+    int instr=-1;
+    int cycle_count=0;
+    int cycles_required=-999;
+    int chain_cycle=0;  // cycle_count at which the first elements of a vector result are ready
+    unsigned char op=OP_NONE;
+    unsigned char vl=0;
+    bool chained_j=false;
+    bool chained_k=false;
+    bool chain_sent=false;
+    bool executing=false;
+    bool busy=false;
+} reservation_station;
+
+typedef struct load_store_rs
+{
+    double address=0;
+    int num;
+    int instr=-1;
+    int dest_tag=0;
+    int tag=0;
+    int src=-1;
+    int cycle_count=0;
+    int cycles_required=-999;
+    int chain_cycle=0;
+    unsigned char op=OP_NONE;
+    unsigned char vl=0;
+    bool chained=false;
+    bool chain_sent=false;
+    bool executing=false;
+    bool busy=false;
+} load_store_rs;
+
+typedef struct machine_config
+{
+    int addCycles;
+    int subCycles;
+    int multCycles;
+    int diviCycles;
+    int loadCycles;
+    int storeCycles;
+    int addReservationStations;
+    int mulReservationStations;
+    int loadReservationStations;
+    int storeReservationStations;
+    int numRegisters;
+    int numPhysRegisters;
+    int numVectorRegisters;
+    int numPhysVectorRegisters;
+    int maxVectorLength;
+    int vectorLanes;
+    const float* dataRegisters;
+} machine_config;
+
+// machine shape read from the machine_config at run time
+typedef struct runtime_shape
+{
+    const machine_config* config;
+    int addCycles() const { return config->addCycles; }
+    int subCycles() const { return config->subCycles; }
+    int multCycles() const { return config->multCycles; }
+    int diviCycles() const { return config->diviCycles; }
+    int loadCycles() const { return config->loadCycles; }
+    int storeCycles() const { return config->storeCycles; }
+    int addReservationStations() const { return config->addReservationStations; }
+    int mulReservationStations() const { return config->mulReservationStations; }
+    int loadReservationStations() const { return config->loadReservationStations; }
+    int storeReservationStations() const { return config->storeReservationStations; }
+    int numRegisters() const { return config->numRegisters; }
+    int numPhysRegisters() const { return config->numPhysRegisters; }
+    int maxVectorLength() const { return config->maxVectorLength; }
+    int vectorLanes() const { return config->vectorLanes; }
+    bool matches(const machine_config* c) const { return c == config; }
+} runtime_shape;
+
+// machine shape fixed at compile time - the engine instantiated with it has constant
+// station loop bounds, latencies and register file sizes, so the compiler can unroll and fold them
+template<int ADD_RS, int MUL_RS, int LOAD_RS, int STORE_RS, int NUM_REGISTERS, int NUM_PHYS_REGISTERS,
+    int MAX_VECTOR_LENGTH, int VECTOR_LANES,
+    int ADD_CYCLES, int SUB_CYCLES, int MULT_CYCLES, int DIVI_CYCLES, int LOAD_CYCLES, int STORE_CYCLES>
+struct fixed_shape
+{
+    static constexpr int addCycles() { return ADD_CYCLES; }
+    static constexpr int subCycles() { return SUB_CYCLES; }
+    static constexpr int multCycles() { return MULT_CYCLES; }
+    static constexpr int diviCycles() { return DIVI_CYCLES; }
+    static constexpr int loadCycles() { return LOAD_CYCLES; }
+    static constexpr int storeCycles() { return STORE_CYCLES; }
+    static constexpr int addReservationStations() { return ADD_RS; }
+    static constexpr int mulReservationStations() { return MUL_RS; }
+    static constexpr int loadReservationStations() { return LOAD_RS; }
+    static constexpr int storeReservationStations() { return STORE_RS; }
+    static constexpr int numRegisters() { return NUM_REGISTERS; }
+    static constexpr int numPhysRegisters() { return NUM_PHYS_REGISTERS; }
+    static constexpr int maxVectorLength() { return MAX_VECTOR_LENGTH; }
+    static constexpr int vectorLanes() { return VECTOR_LANES; }
+    // the stations and registers are still laid out from the machine_config, so it has to agree
+    static bool matches(const machine_config* c)
+    {
+        return c->addCycles == ADD_CYCLES and c->subCycles == SUB_CYCLES and c->multCycles == MULT_CYCLES
+            and c->diviCycles == DIVI_CYCLES and c->loadCycles == LOAD_CYCLES and c->storeCycles == STORE_CYCLES
+            and c->addReservationStations == ADD_RS and c->mulReservationStations == MUL_RS
+            and c->loadReservationStations == LOAD_RS and c->storeReservationStations == STORE_RS
+            and c->numRegisters == NUM_REGISTERS and c->numPhysRegisters == NUM_PHYS_REGISTERS
+            and c->maxVectorLength == MAX_VECTOR_LENGTH and c->vectorLanes == VECTOR_LANES;
+    }
+};
+
+// one trace of a multithreaded run - the threads share the stations, the cdb and the physical
+// registers, but each has its own instructions (program[begin] to program[end - 1]) and rename map
+typedef struct hardware_thread
+{
+    const char* filename;
+    int* rename_map;
+    int begin=0;
+    int end=0;
+    int next=0;         // next instruction to issue
+    int written=0;
+    int finish=0;       // cycle the last instruction was written
+    int stall=STALL_NONE;   // what last held up the next instruction
+} hardware_thread;
+
+// how a trace (or a set of threads) is run
+typedef struct run_options
+{
+    int policy=FETCH_RR;
+    bool quiet=false;       // only print the last cycle
+    bool analyze=false;     // print the critical path analysis
+    bool timing=false;      // print how fast the cycles were simulated
+    bool fixed=false;       // run on the engine specialized for the assumptions
+} run_options;
+
+// bump allocator - everything allocated for a run is released at once by arenaReset
+typedef struct arena
+{
+    char* base=NULL;
+    size_t capacity=0;
+    size_t used=0;
+} arena;
+
+typedef struct tomasulo
+{
+    const machine_config* config;
+    decoded_instruction* program;
+    instruction_status* status;
+    hardware_thread* threads;
+    physical_register* phys_registers;  // scalar registers, then vector registers
+    double* vector_data;
+    int* free_list;
+    int* vector_free_list;
+    int* path_cycles;   // cycles of the critical path charged to each instruction, by cause - if analysed
+    reservation_station* add_reserv_stat;
+    reservation_station* mul_reserv_stat;
+    load_store_rs* load_reserv_stat;
+    load_store_rs* store_reserv_stat;
+    int lineCount=0;
+    int numThreads=1;
+    int policy=FETCH_RR;
+    int issuingThread=-1;
+    int completedInstr=0;
+    int issuedInstr=0;
+    int writtenInstr=0;
+    int clockCycles=0;
+    int completed_rs=-1;
+    int completed_instr=-1;
+    int completed_tag=0;
+    int written_instr=-1;   // instruction written this cycle
+    int chain_tag=0;
+    int freeCount=0;
+    int vectorFreeCount=0;
+    int renameStalls=0;
+    int stationStalls=0;
+    int stall=STALL_NONE;   // what held up issue this cycle
+    double cdb_data=0;
+    bool issueSuccessful=false;
+    bool cdb_busy=false;
+    bool hasVector=false;
+} tomasulo;
+
+typedef struct breakpoint
+{
+    int kind;
+    int value;
+} breakpoint;
+
+enum breakpoint_kind
+{
+    BREAK_CYCLE=0,
+    BREAK_ISSUE,
+    BREAK_FULL
+};
+
+// copy of the machine state (everything in the arena from the simulator on) at the start of a cycle
+typedef struct snapshot
+{
+    int cycle;
+    char* bytes;
+} snapshot;
+
+typedef struct debugger
+{
+    arena* a;
+    tomasulo* sim;
+    breakpoint breakpoints[MAX_BREAKPOINTS];
+    snapshot snapshots[MAX_SNAPSHOTS];
+    int numBreakpoints=0;
+    int numSnapshots=0;
+    int snapshotInterval=1;
+} debugger;
+
+// critical path cycles charged so far, walking back from the end of the run
+typedef struct path_analysis
+{
+    int* cycles;        // per instruction and cause
+    int causes[numPathCauses];
+    int resources[numResources];
+    int now;            // every cycle after this one has been charged
+} path_analysis;
+
+bool arenaReserve(arena* a, size_t bytes);
+void arenaReset(arena* a);
+void arenaFree(arena* a);
+void* arenaAlloc(arena* a, size_t bytes, size_t align);
+template<typename T> T* arenaArray(arena* a, int n);
+template<typename T> size_t arenaBytes(int n);
+
+bool isVectorOp(int op);
+int registerIndex(const char* name, int numRegisters);
+int vectorRegisterIndex(const char* name, const machine_config* config);
+int vectorLengthDirective(const char* line);
+bool decodeInstruction(char* line, decoded_instruction* instr, const machine_config* config, int vl);
+bool isBlankLine(const char* line);
+tomasulo* loadSimulator(const char* const* filenames, int numThreads, const machine_config* config, arena* a, bool analyze);
+template<typename S> int simulate(const char* const* filenames, int numThreads, const machine_config* config, arena* a, const S& shape, const run_options& options);
+int debug(const char* filename, const machine_config* config, arena* a);
+template<bool PRINT, typename S> void stepCycle(tomasulo* sim, const S& shape);
+void stepCycle(tomasulo* sim);
+template<typename S> void issueInstruction(tomasulo* sim, const S& shape);
+template<typename S> void writeResult(tomasulo* sim, const S& shape);
+template<bool PRINT, typename S> void executeStations(tomasulo* sim, const S& shape);
+void advanceClock(tomasulo* sim);
+void printCycle(tomasulo* sim);
+void printThreads(tomasulo* sim);
+void analyzeRun(tomasulo* sim);
+int threadOf(tomasulo* sim, int instr);
+
+void header(int n);
+template<typename T> void printElement(T t, const int& width);
+template<typename T> void printInstructionStatus(T t, const int& width);
+template<typename T> void printLoadStatus(T t, const int& width);
+template<typename T> void printStoreStatus(T t, const int& width);
+template<typename T> void printStationStatus(T t, const int& width);
+template<typename T> void printRegisterStatus(T t, const int& numRegisters);
+template<typename T> void printVectorStatus(T t, const int& maxVectorLength);
+template<typename T> void printPhysicalStatus(T t, const int& width);
+template<typename T> void printThreadStatus(T t, const int& width);
+template<typename T> void printCauseStatus(T t, const int& width);
+template<typename T> void printResourceStatus(T t, const int& width);
+template<typename T> void printHotStatus(T t, const int& width);
+
+int main(int argc, char* argv[]) {
+    // ==================== ASSUMPTIONS ====================
+    const int addCycles = 2;
+    const int subCycles = 2;
+    //const int multCycles = 10;
+    const int multCycles = 3;
+    const int diviCycles = 40;
+    const int loadCycles = 3;
+    const int storeCycles = 3;
+    const int addReservationStations = 2;
+    const int mulReservationStations = 2;
+    const int loadReservationStations = 2;
+    const int storeReservationStations = 2;
+    const int numRegisters = 6;
+    const int numPhysRegisters = 32;
+    const int numVectorRegisters = 8;
+    const int numPhysVectorRegisters = 32;
+    const int maxVectorLength = 8;
+    const int vectorLanes = 2;
+    // add or delete entries depending on value of numRegisters
+    float dataRegisters[numRegisters] = {6, 3.5, 10, 0, 7.8, 2};
+    const char* filename = "raw.txt";
+    //const char* filename = "waw.txt";
+    //const char* filename = "war.txt";
+    //const char* filename = "sdld.txt";
+    //const char* filename = "stall.txt";
+    //const char* filename = "long.txt";
+    //const char* filename = "vector.txt";
+
+    machine_config config;
+    config.addCycles = addCycles;
+    config.subCycles = subCycles;
+    config.multCycles = multCycles;
+    config.diviCycles = diviCycles;
+    config.loadCycles = loadCycles;
+    config.storeCycles = storeCycles;
+    config.addReservationStations = addReservationStations;
+    config.mulReservationStations = mulReservationStations;
+    config.loadReservationStations = loadReservationStations;
+    config.storeReservationStations = storeReservationStations;
+    config.numRegisters = numRegisters;
+    config.numPhysRegisters = numPhysRegisters;
+    config.numVectorRegisters = numVectorRegisters;
+    config.numPhysVectorRegisters = numPhysVectorRegisters;
+    config.maxVectorLength = maxVectorLength;
+    config.vectorLanes = vectorLanes;
+    config.dataRegisters = dataRegisters;
+
+    // both engines are built - the fixed one is selected with -f
+    typedef fixed_shape<addReservationStations, mulReservationStations, loadReservationStations, storeReservationStations,
+        numRegisters, numPhysRegisters, maxVectorLength, vectorLanes,
+        addCycles, subCycles, multCycles, diviCycles, loadCycles, storeCycles> fixed_machine;
+    fixed_machine fixed;
+    runtime_shape shape;
+    shape.config = &config;
+
+    // ==================== RUN SIMULATIONS ====================
+    // the arena is allocated once and reused by every run
+    arena run_arena;
+    if (!arenaReserve(&run_arena, ARENA_BYTES)) {
+        printf("Could not allocate %i bytes", ARENA_BYTES);
+        return 1;
+    }
+
+    int failed = 0;
+    if (argc >= 2 and strcmp(argv[1], "-d") == 0) {
+        failed = debug(argc > 2 ? argv[2] : filename, &config, &run_arena);
+        arenaFree(&run_arena);
+        return failed;
+    }
+    run_options options;
+    bool threads = false;
+    int first = 1;
+    while (first < argc and argv[first][0] == '-') {
+        if (strcmp(argv[first], "-q") == 0) {
+            options.quiet = true;
+        }
+        else if (strcmp(argv[first], "-a") == 0) {
+            options.analyze = true;
+        }
+        else if (strcmp(argv[first], "-s") == 0) {
+            options.quiet = true;
+            options.timing = true;
+        }
+        else if (strcmp(argv[first], "-f") == 0) {
+            options.fixed = true;
+        }
+        else if (strcmp(argv[first], "-t") == 0 and first + 1 < argc) {
+            first += 1;
+            options.policy = -1;
+            for (int i=0; i < numFetchPolicies; i++) {
+                if (strcmp(argv[first], fetch_policy_names[i]) == 0) {
+                    options.policy = i;
+                }
+            }
+            if (options.policy == -1) {
+                printf("Unknown fetch policy %s", argv[first]);
+                arenaFree(&run_arena);
+                return 1;
+            }
+            threads = true;
+        }
+        else {
+            printf("Unknown option %s", argv[first]);
+            arenaFree(&run_arena);
+            return 1;
+        }
+        first += 1;
+    }
+    const char* const* traces = (const char* const*) argv + first;
+    int numTraces = argc - first;
+    if (numTraces == 0) {
+        traces = &filename;
+        numTraces = 1;
+    }
+    else if (threads) {
+        // every trace is a thread of the same run
+        cout << "Threads:";
+        for (int i=0; i < numTraces; i++) {
+            cout << " " << traces[i];
+        }
+        cout << endl << endl;
+    }
+    for (int i=0; i < (threads ? 1 : numTraces); i++) {
+        const char* const* filenames = threads ? traces : traces + i;
+        const int numThreads = threads ? numTraces : 1;
+        if (!threads and argc > first) {
+            cout << "Trace: " << traces[i] << endl << endl;
+        }
+        int result;
+        if (options.fixed) {
+            result = simulate(filenames, numThreads, &config, &run_arena, fixed, options);
+        }
+        else result = simulate(filenames, numThreads, &config, &run_arena, shape, options);
+        if (result != 0) {
+            cout << endl;
+            failed = 1;
+        }
+    }
+
+    arenaFree(&run_arena);
+    return failed;
+}
+
+
+// ================== ARENA FUNCTIONS ==================
+// only called while nothing is allocated (before the first run or right after a reset)
+bool arenaReserve(arena* a, size_t bytes)
+{
+    if (a->used != 0) {
+        return false;
+    }
+    if (bytes <= a->capacity) {
+        return true;
+    }
+    char* base = (char*) malloc(bytes);
+    if (base == NULL) {
+        return false;
+    }
+    free(a->base);
+    a->base = base;
+    a->capacity = bytes;
+    return true;
+}
+
+void arenaReset(arena* a)
+{
+    a->used = 0;
+}
+
+void arenaFree(arena* a)
+{
+    free(a->base);
+    a->base = NULL;
+    a->capacity = 0;
+    a->used = 0;
+}
+
+void* arenaAlloc(arena* a, size_t bytes, size_t align)
+{
+    size_t start = (a->used + align - 1) & ~(align - 1);
+    if (start + bytes > a->capacity) {
+        return NULL;
+    }
+    a->used = start + bytes;
+    return a->base + start;
+}
+
+template<typename T> T* arenaArray(arena* a, int n)
+{
+    T* t = (T*) arenaAlloc(a, sizeof(T) * n, alignof(T));
+    if (t == NULL) {
+        return NULL;
+    }
+    for (int i=0; i < n; i++) {
+        new (&t[i]) T();
+    }
+    return t;
+}
+
+// upper bound on the space arenaArray<T>(n) takes, including alignment padding
+template<typename T> size_t arenaBytes(int n)
+{
+    return sizeof(T) * n + alignof(T);
+}
+
+
+// ================== READ IN INSTRUCTIONS ==================
+bool isVectorOp(int op)
+{
+    return op >= OP_VLD;
+}
+
+// returns the index of register "R<2i>", or -1 if there is no such register
+int registerIndex(const char* name, int numRegisters)
+{
+    if (name == NULL or name[0] != 'R') {
+        return -1;
+    }
+    char* end;
+    long n = strtol(name + 1, &end, 10);
+    if (end == name + 1 or *end != '\0' or n < 0 or n % 2 != 0 or n / 2 >= numRegisters) {
+        return -1;
+    }
+    return (int) n / 2;
+}
+
+// returns numRegisters + n for vector register "V<n>", or -1 if there is no such register
+int vectorRegisterIndex(const char* name, const machine_config* config)
+{
+    if (name == NULL or name[0] != 'V') {
+        return -1;
+    }
+    char* end;
+    long n = strtol(name + 1, &end, 10);
+    if (end == name + 1 or *end != '\0' or n < 0 or n >= config->numVectorRegisters) {
+        return -1;
+    }
+    return config->numRegisters + (int) n;
+}
+
+// returns the length set by a "VL <n>" line, or -1 if the line is not one
+int vectorLengthDirective(const char* line)
+{
+    int n;
+    if (sscanf(line, " VL %d", &n) == 1) {
+        return n;
+    }
+    return -1;
+}
+
+bool isBlankLine(const char* line)
+{
+    for (int i=0; line[i] != '\0'; i++) {
+        if (line[i] != ' ' and line[i] != '\t' and line[i] != '\n' and line[i] != '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+int decodeRegister(const char* name, int op, const machine_config* config)
+{
+    if (isVectorOp(op)) {
+        return vectorRegisterIndex(name, config);
+    }
+    return registerIndex(name, config->numRegisters);
+}
+
+bool decodeInstruction(char* line, decoded_instruction* instr, const machine_config* config, int vl)
+{
+    const char s[5] = " \t\r\n";
+    char *token;
+
+    token = strtok(line, s);
+    instr->op = OP_NONE;
+    for (int i=1; i < numOpcodes; i++) {
+        if (token != NULL and strcmp(token, opcode_names[i]) == 0) {
+            instr->op = i;
+        }
+    }
+    if (instr->op == OP_NONE) {
+        return false;
+    }
+    if (isVectorOp(instr->op)) {
+        instr->vl = vl;
+    }
+    const bool load = instr->op == OP_LD or instr->op == OP_VLD;
+    const bool store = instr->op == OP_SD or instr->op == OP_VST;
+
+    token = strtok(NULL, s);
+    instr->dest = decodeRegister(token, instr->op, config);
+
+    token = strtok(NULL, s);
+    if (load) {
+        if (token == NULL) {
+            return false;
+        }
+        instr->load = atoi(token);
+    }
+    else {
+        instr->reg_j = decodeRegister(token, instr->op, config);
+    }
+
+    /* read in last part of instruction, if not load or store */
+    if (load or store)
+    {
+        instr->reg_k = -1;
+    }
+    else
+    {
+        token = strtok(NULL, s);
+        instr->reg_k = decodeRegister(token, instr->op, config);
+        if (instr->reg_k == -1) {
+            return false;
+        }
+    }
+
+    return instr->dest != -1 and (load or instr->reg_j != -1);
+}
+
+// reads and decodes the traces (one per thread, one after the other in the program), then lays
+// out the simulator in the (already reset) arena
+tomasulo* loadSimulator(const char* const* filenames, int numThreads, const machine_config* config, arena* a, bool analyze)
+{
+    FILE *fp;
+    char mystring[MAXCHAR];
+
+    int lineCount = 0;
+    for (int t=0; t < numThreads; t++) {
+        fp = fopen(filenames[t], "r");
+        if (fp == NULL){
+            printf("Could not open file %s",filenames[t]);
+            return NULL;
+        }
+        while (fgets(mystring, MAXCHAR, fp) != NULL){
+            if (!isBlankLine(mystring) and vectorLengthDirective(mystring) == -1) {
+                lineCount += 1;
+            }
+        }
+        fclose(fp);
+    }
+
+    const int addRS = config->addReservationStations;
+    const int mulRS = config->mulReservationStations;
+    const int loadRS = config->loadReservationStations;
+    const int storeRS = config->storeReservationStations;
+    const int numArchRegisters = config->numRegisters + config->numVectorRegisters;
+    const int numPhysRegisters = config->numPhysRegisters + config->numPhysVectorRegisters;
+    if (config->numPhysRegisters <= config->numRegisters * numThreads) {
+        printf("numPhysRegisters must be greater than numRegisters times the number of threads (%i)", config->numRegisters * numThreads);
+        return NULL;
+    }
+    if (config->maxVectorLength < 1 or config->maxVectorLength > 255 or config->vectorLanes < 1) {
+        printf("maxVectorLength must be between 1 and 255, and vectorLanes at least 1");
+        return NULL;
+    }
+    size_t bytes = arenaBytes<tomasulo>(1)
+        + arenaBytes<decoded_instruction>(lineCount)
+        + arenaBytes<int>(analyze ? lineCount * numPathCauses : 0)
+        + arenaBytes<instruction_status>(lineCount)
+        + arenaBytes<hardware_thread>(numThreads)
+        + arenaBytes<physical_register>(numPhysRegisters)
+        + arenaBytes<double>(config->numPhysVectorRegisters * config->maxVectorLength)
+        + arenaBytes<int>(numArchRegisters * numThreads)
+        + arenaBytes<int>(config->numPhysRegisters)
+        + arenaBytes<int>(config->numPhysVectorRegisters)
+        + arenaBytes<reservation_station>(addRS + mulRS)
+        + arenaBytes<load_store_rs>(loadRS)
+        + arenaBytes<load_store_rs>(storeRS);
+    if (!arenaReserve(a, bytes)) {
+        printf("Could not allocate %zu bytes for %s", bytes, filenames[0]);
+        return NULL;
+    }
+
+    // the program never changes, the status of an instruction is only ever filled in (so going
+    // back just clears what was recorded later) and the analysis is only made of a finished run,
+    // so they go first and everything from sim on is the state a debugger snapshot has to copy
+    decoded_instruction* program = arenaArray<decoded_instruction>(a, lineCount);
+    instruction_status* status = arenaArray<instruction_status>(a, lineCount);
+    int* path_cycles = analyze ? arenaArray<int>(a, lineCount * numPathCauses) : NULL;
+    tomasulo* sim = arenaArray<tomasulo>(a, 1);
+    sim->config = config;
+    sim->lineCount = lineCount;
+    sim->numThreads = numThreads;
+    sim->program = program;
+    sim->path_cycles = path_cycles;
+    sim->status = status;
+    sim->threads = arenaArray<hardware_thread>(a, numThreads);
+    sim->phys_registers = arenaArray<physical_register>(a, numPhysRegisters);
+    sim->vector_data = arenaArray<double>(a, config->numPhysVectorRegisters * config->maxVectorLength);
+    int* rename_maps = arenaArray<int>(a, numArchRegisters * numThreads);
+    sim->free_list = arenaArray<int>(a, config->numPhysRegisters);
+    sim->vector_free_list = arenaArray<int>(a, config->numPhysVectorRegisters);
+    sim->add_reserv_stat = arenaArray<reservation_station>(a, addRS + mulRS);
+    sim->mul_reserv_stat = sim->add_reserv_stat + addRS;
+    sim->load_reserv_stat = arenaArray<load_store_rs>(a, loadRS);
+    sim->store_reserv_stat = arenaArray<load_store_rs>(a, storeRS);
+
+    int instr = 0;
+    for (int t=0; t < numThreads; t++) {
+        hardware_thread& thread = sim->threads[t];
+        thread.filename = filenames[t];
+        thread.rename_map = rename_maps + t * numArchRegisters;
+        thread.begin = instr;
+        thread.next = instr;
+
+        fp = fopen(filenames[t], "r");
+        if (fp == NULL){
+            printf("Could not open file %s",filenames[t]);
+            return NULL;
+        }
+        int line = 0;
+        int vl = config->maxVectorLength;
+        while (fgets(mystring, MAXCHAR, fp) != NULL and instr < lineCount){
+            line += 1;
+            if (isBlankLine(mystring)) {
+                continue;
+            }
+            int directive = vectorLengthDirective(mystring);
+            if (directive != -1) {
+                if (directive < 1 or directive > config->maxVectorLength) {
+                    printf("Invalid vector length on line %i of %s", line, filenames[t]);
+                    fclose(fp);
+                    return NULL;
+                }
+                vl = directive;
+                continue;
+            }
+            if (!decodeInstruction(mystring, &sim->program[instr], config, vl)) {
+                printf("Invalid instruction on line %i of %s", line, filenames[t]);
+                fclose(fp);
+                return NULL;
+            }
+            if (isVectorOp(sim->program[instr].op)) {
+                sim->hasVector = true;
+            }
+            instr += 1;
+        }
+        fclose(fp);
+        thread.end = instr;
+    }
+
+    // ==================== STRUCTURE INITIALIZATION ====================
+    // architectural register i of thread t starts out in physical register t*numRegisters + i,
+    // the rest are free
+    for (int t=0; t < numThreads; t++) {
+        for (int i=0; i < config->numRegisters; i++){
+            const int p = t * config->numRegisters + i;
+            sim->phys_registers[p].data = config->dataRegisters[i];
+            sim->phys_registers[p].mapped = true;
+            sim->threads[t].rename_map[i] = p;
+        }
+    }
+    for (int i=config->numPhysRegisters - 1; i >= config->numRegisters * numThreads; i--) {
+        sim->free_list[sim->freeCount] = i;
+        sim->freeCount += 1;
+    }
+    // likewise for vector registers, which start out zeroed - only set up if a trace uses them,
+    // so scalar traces can run on more threads than there are vector registers for
+    if (sim->hasVector) {
+        const int mappedVectors = config->numVectorRegisters * numThreads;
+        if (config->numVectorRegisters > 0 and config->numPhysVectorRegisters <= mappedVectors) {
+            printf("numPhysVectorRegisters must be greater than numVectorRegisters times the number of threads (%i)", mappedVectors);
+            return NULL;
+        }
+        for (int t=0; t < numThreads; t++) {
+            for (int i=0; i < config->numVectorRegisters; i++) {
+                const int p = config->numPhysRegisters + t * config->numVectorRegisters + i;
+                sim->phys_registers[p].mapped = true;
+                sim->threads[t].rename_map[config->numRegisters + i] = p;
+            }
+        }
+        for (int i=config->numPhysVectorRegisters - 1; i >= mappedVectors; i--) {
+            sim->vector_free_list[sim->vectorFreeCount] = config->numPhysRegisters + i;
+            sim->vectorFreeCount += 1;
+        }
+    }
+    else {
+        for (int t=0; t < numThreads; t++) {
+            for (int i=0; i < config->numVectorRegisters; i++) {
+                sim->threads[t].rename_map[config->numRegisters + i] = -1;
+            }
+        }
+    }
+
+    // each reservation station needs a unique number
+    for (int i=0; i < addRS + mulRS; i++) {
+        sim->add_reserv_stat[i].num = i + 1;
+    }
+    for (int i=0; i < loadRS; i++) {
+        sim->load_reserv_stat[i].num = addRS + mulRS + i + 1;
+    }
+    for (int i=0; i < storeRS; i++) {
+        sim->store_reserv_stat[i].num = addRS + mulRS + loadRS + i + 1;
+    }
+
+    return sim;
+}
+
+
+// ==================== MAIN SIMULATION LOOP ====================
+template<typename S> int simulate(const char* const* filenames, int numThreads, const machine_config* config, arena* a, const S& shape, const run_options& options)
+{
+    if (!shape.matches(config)) {
+        printf("The machine configuration does not match the one the simulator was built for");
+        return 1;
+    }
+    arenaReset(a);
+    tomasulo* sim = loadSimulator(filenames, numThreads, config, a, options.analyze);
+    if (sim == NULL) {
+        return 1;
+    }
+    sim->policy = options.policy;
+
+    // quiet runs step without printing up to the last cycle, which is still printed
+    clock_t start = clock();
+    if (options.quiet) {
+        while (sim->writtenInstr < sim->lineCount and !(sim->writtenInstr + 1 == sim->lineCount and sim->completed_rs != -1)) {
+            stepCycle<false>(sim, shape);
+        }
+    }
+    const int quietCycles = sim->clockCycles;
+    const double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    while (sim->writtenInstr < sim->lineCount) {
+        stepCycle<true>(sim, shape);
+    }
+    if (options.timing) {
+        printf("Simulated %i cycles in %.3f seconds (%.0f cycles per second)\n\n", quietCycles, seconds,
+            seconds > 0 ? quietCycles / seconds : 0);
+    }
+    if (sim->numThreads > 1) {
+        printThreads(sim);
+    }
+    if (options.analyze) {
+        analyzeRun(sim);
+    }
+
+    return 0;
+}
+
+template<bool PRINT, typename S> void stepCycle(tomasulo* sim, const S& shape)
+{
+    writeResult(sim, shape);
+    issueInstruction(sim, shape);
+    executeStations<PRINT>(sim, shape);
+    if (PRINT) {
+        printCycle(sim);
+    }
+    advanceClock(sim);
+}
+
+// steps the runtime engine without printing, for the debugger
+void stepCycle(tomasulo* sim)
+{
+    runtime_shape shape;
+    shape.config = sim->config;
+    stepCycle<false>(sim, shape);
+}
+
+// ================== WRITING INSTRUCTIONS ==================
+int threadOf(tomasulo* sim, int instr)
+{
+    int t = 0;
+    while (instr >= sim->threads[t].end) {
+        t += 1;
+    }
+    return t;
+}
+
+template<typename S> bool isVectorRegister(const S& shape, int p)
+{
+    return p >= shape.numPhysRegisters();
+}
+
+template<typename S> double* vectorElements(tomasulo* sim, int p, const S& shape)
+{
+    return sim->vector_data + (p - shape.numPhysRegisters()) * shape.maxVectorLength();
+}
+
+double* vectorElements(tomasulo* sim, int p)
+{
+    runtime_shape shape;
+    shape.config = sim->config;
+    return vectorElements(sim, p, shape);
+}
+
+// a physical register can be reused once it has been written and remapped, and no station still reads it
+template<typename S> void releaseRegister(tomasulo* sim, int p, const S& shape)
+{
+    const physical_register& reg = sim->phys_registers[p];
+    if (reg.mapped or !reg.ready or reg.readers != 0) {
+        return;
+    }
+    if (isVectorRegister(shape, p)) {
+        sim->vector_free_list[sim->vectorFreeCount] = p;
+        sim->vectorFreeCount += 1;
+    }
+    else {
+        sim->free_list[sim->freeCount] = p;
+        sim->freeCount += 1;
+    }
+}
+
+bool operandsReady(const reservation_station& station)
+{
+    return (station.tag_j == 0 or station.chained_j) and (station.tag_k == 0 or station.chained_k);
+}
+
+void broadcastStations(reservation_station* stations, int count, int completed_rs, int completed_tag, double cdb_data)
+{
+    for (int i=0; i < count; i++) {
+        if (stations[i].tag_j == completed_tag) {
+            stations[i].data_j = cdb_data;
+            stations[i].tag_j = 0;
+            if (operandsReady(stations[i])) {
+                stations[i].executing = true;
+            }
+        }
+        if (stations[i].tag_k == completed_tag) {
+            stations[i].data_k = cdb_data;
+            stations[i].tag_k = 0;
+            if (operandsReady(stations[i])) {
+                stations[i].executing = true;
+            }
+        }
+
+        // clear reservation station
+        if (stations[i].num == completed_rs) {
+            stations[i].busy = false;
+            stations[i].cycle_count = 0;
+            stations[i].cycles_required = -999;
+            stations[i].executing = false;
+            stations[i].instr = -1;
+            stations[i].dest_tag = 0;
+            stations[i].src_j = -1;
+            stations[i].src_k = -1;
+            stations[i].vl = 0;
+            stations[i].chained_j = false;
+            stations[i].chained_k = false;
+            stations[i].chain_sent = false;
+        }
+    }
+}
+
+void broadcastStations(load_store_rs* stations, int count, int completed_rs, int completed_tag, double cdb_data)
+{
+    for (int i=0; i < count; i++) {
+        if (stations[i].tag == completed_tag) {
+            stations[i].address = cdb_data;
+            stations[i].tag = 0;
+            stations[i].executing = true;
+        }
+        // clear reservation station
+        if (stations[i].num == completed_rs) {
+            stations[i].busy = false;
+            stations[i].cycle_count = 0;
+            stations[i].cycles_required = -999;
+            stations[i].executing = false;
+            stations[i].instr = -1;
+            stations[i].dest_tag = 0;
+            stations[i].src = -1;
+            stations[i].vl = 0;
+            stations[i].chained = false;
+            stations[i].chain_sent = false;
+        }
+    }
+}
+
+// the first elements of a vector are on the cdb - stations waiting for it can start
+void chainStations(reservation_station* stations, int count, int chain_tag)
+{
+    for (int i=0; i < count; i++) {
+        if (stations[i].tag_j == chain_tag) {
+            stations[i].chained_j = true;
+        }
+        if (stations[i].tag_k == chain_tag) {
+            stations[i].chained_k = true;
+        }
+        if (stations[i].busy and operandsReady(stations[i])) {
+            stations[i].executing = true;
+        }
+    }
+}
+
+void chainStations(load_store_rs* stations, int count, int chain_tag)
+{
+    for (int i=0; i < count; i++) {
+        if (stations[i].tag == chain_tag) {
+            stations[i].chained = true;
+            stations[i].executing = true;
+        }
+    }
+}
+
+template<typename S> void writeResult(tomasulo* sim, const S& shape)
+{
+    if (sim->chain_tag != 0) {
+        chainStations(sim->add_reserv_stat, shape.addReservationStations() + shape.mulReservationStations(), sim->chain_tag);
+        chainStations(sim->store_reserv_stat, shape.storeReservationStations(), sim->chain_tag);
+        sim->chain_tag = 0;
+    }
+    sim->written_instr = -1;
+    if (sim->completed_rs == -1) {
+        return;
+    }
+    // broadcast_data
+    broadcastStations(sim->add_reserv_stat, shape.addReservationStations() + shape.mulReservationStations(), sim->completed_rs, sim->completed_tag, sim->cdb_data);
+    broadcastStations(sim->load_reserv_stat, shape.loadReservationStations(), sim->completed_rs, sim->completed_tag, sim->cdb_data);
+    broadcastStations(sim->store_reserv_stat, shape.storeReservationStations(), sim->completed_rs, sim->completed_tag, sim->cdb_data);
+
+    // write to the physical register - every waiting scalar station has just taken the value,
+    // so if the register has already been remapped only vector stations can read it again
+    // (vector results are already in place, see completeVector)
+    int p = sim->completed_tag - 1;
+    if (!isVectorRegister(shape, p)) {
+        sim->phys_registers[p].data = sim->cdb_data;
+    }
+    sim->phys_registers[p].ready = true;
+    releaseRegister(sim, p, shape);
+
+    // just for bookkeeping - instruction written cycle number
+    if (sim->status[sim->completed_instr].written == -1) {
+        sim->status[sim->completed_instr].written = sim->clockCycles;
+    }
+    sim->written_instr = sim->completed_instr;
+
+    sim->writtenInstr += 1;
+    hardware_thread& thread = sim->threads[threadOf(sim, sim->completed_instr)];
+    thread.written += 1;
+    if (thread.written == thread.end - thread.begin) {
+        thread.finish = sim->clockCycles;
+    }
+    // reset
+    sim->completed_rs = -1;
+    sim->completed_instr = -1;
+    sim->completed_tag = 0;
+    sim->cdb_data = 0;
+}
+
+// ================== ISSUING INSTRUCTIONS ==================
+// instruction in reservation station rs (numbered from 1)
+template<typename S> int stationInstr(tomasulo* sim, int rs, const S& shape)
+{
+    const int arithRS = shape.addReservationStations() + shape.mulReservationStations();
+    if (rs <= arithRS) {
+        return sim->add_reserv_stat[rs - 1].instr;
+    }
+    if (rs <= arithRS + shape.loadReservationStations()) {
+        return sim->load_reserv_stat[rs - arithRS - 1].instr;
+    }
+    return sim->store_reserv_stat[rs - arithRS - shape.loadReservationStations() - 1].instr;
+}
+
+// instruction that will write the value with this tag, or -1 if the value was ready
+template<typename S> int producerInstr(tomasulo* sim, int tag, const S& shape)
+{
+    if (tag == 0) {
+        return -1;
+    }
+    return stationInstr(sim, sim->phys_registers[tag - 1].producer, shape);
+}
+
+// copies the register value into the station, or the tag (physical register + 1) that will hold it
+void readOperand(tomasulo* sim, const int* rename_map, int reg, double* data, int* tag)
+{
+    int p = rename_map[reg];
+    if (sim->phys_registers[p].ready) {
+        *data = sim->phys_registers[p].data;
+    }
+    else {
+        *tag = p + 1;
+    }
+}
+
+// vectors are not copied into the station - it keeps the physical register (which can not be
+// reused until the station has read it), and the tag if the vector has not been written yet
+void readVector(tomasulo* sim, const int* rename_map, int reg, int* src, int* tag)
+{
+    int p = rename_map[reg];
+    *src = p;
+    sim->phys_registers[p].readers += 1;
+    if (!sim->phys_registers[p].ready) {
+        *tag = p + 1;
+    }
+}
+
+template<typename S> int freeRegisters(tomasulo* sim, int reg, const S& shape)
+{
+    if (reg >= shape.numRegisters()) {
+        return sim->vectorFreeCount;
+    }
+    return sim->freeCount;
+}
+
+// maps the destination to a register from the free list, and returns its tag
+// the old physical register is released now if its value has already been written (and read),
+// otherwise when it is
+template<typename S> int renameRegister(tomasulo* sim, int* rename_map, int reg, int station, const S& shape)
+{
+    int p;
+    if (reg >= shape.numRegisters()) {
+        sim->vectorFreeCount -= 1;
+        p = sim->vector_free_list[sim->vectorFreeCount];
+    }
+    else {
+        sim->freeCount -= 1;
+        p = sim->free_list[sim->freeCount];
+    }
+    int old = rename_map[reg];
+    sim->phys_registers[old].mapped = false;
+    releaseRegister(sim, old, shape);
+    rename_map[reg] = p;
+    sim->phys_registers[p].ready = false;
+    sim->phys_registers[p].mapped = true;
+    sim->phys_registers[p].producer = station;
+    return p + 1;
+}
+
+int freeStation(reservation_station* stations, int count)
+{
+    for (int l=0; l < count; l++) {
+        if (stations[l].busy == false) {
+            return l;
+        }
+    }
+    return -1;
+}
+
+int freeStation(load_store_rs* stations, int count)
+{
+    for (int l=0; l < count; l++) {
+        if (stations[l].busy == false) {
+            return l;
+        }
+    }
+    return -1;
+}
+
+template<typename S> int opCycles(const S& shape, int op)
+{
+    switch (op) {
+        case OP_LD: case OP_VLD: return shape.loadCycles();
+        case OP_SD: case OP_VST: return shape.storeCycles();
+        case OP_ADDD: case OP_VADDD: return shape.addCycles();
+        case OP_SUBD: case OP_VSUBD: return shape.subCycles();
+        case OP_MULTD: case OP_VMULTD: return shape.multCycles();
+        default: return shape.diviCycles();
+    }
+}
+
+// one more cycle for every group of vectorLanes elements after the first
+template<typename S> int vectorGroups(const S& shape, int vl)
+{
+    return (vl + shape.vectorLanes() - 1) / shape.vectorLanes();
+}
+
+// tries to issue the next instruction of thread t, and returns what held it up (STALL_NONE if it issued)
+template<typename S> int issueFrom(tomasulo* sim, int t, const S& shape)
+{
+    hardware_thread& thread = sim->threads[t];
+    // issue instruction 0...then 1...then n..etc. (& increment instruction cycle if successful)
+    const decoded_instruction& instr = sim->program[thread.next];
+    instruction_status& status = sim->status[thread.next];
+    const bool load = instr.op == OP_LD or instr.op == OP_VLD;
+    const bool store = instr.op == OP_SD or instr.op == OP_VST;
+    const bool vector = isVectorOp(instr.op);
+
+    // every instruction writes a register, so it needs a free physical register
+    if (freeRegisters(sim, store ? instr.reg_j : instr.dest, shape) == 0) {
+        return STALL_REGS;
+    }
+
+    int cycles = opCycles(shape, instr.op);
+    if (vector) {
+        cycles += vectorGroups(shape, instr.vl) - 1;
+    }
+
+    if (load or store) {
+        load_store_rs* stations = sim->load_reserv_stat;
+        int count = shape.loadReservationStations();
+        if (store) {
+            stations = sim->store_reserv_stat;
+            count = shape.storeReservationStations();
+        }
+        int l = freeStation(stations, count);
+        if (l == -1) {
+            return store ? STALL_STORE : STALL_LOAD;
+        }
+        load_store_rs& station = stations[l];
+        if (load) {
+            // load value
+            station.address = instr.load;
+            // destination register
+            station.dest_tag = renameRegister(sim, thread.rename_map, instr.dest, station.num, shape);
+        }
+        else {
+            // store reads the source register, and writes the register named in j
+            if (vector) {
+                readVector(sim, thread.rename_map, instr.dest, &station.src, &station.tag);
+            }
+            else {
+                readOperand(sim, thread.rename_map, instr.dest, &station.address, &station.tag);
+            }
+            status.producer_j = producerInstr(sim, station.tag, shape);
+            // destination register
+            station.dest_tag = renameRegister(sim, thread.rename_map, instr.reg_j, station.num, shape);
+        }
+        station.busy = true;
+        station.op = instr.op;
+        station.vl = instr.vl;
+        station.instr = thread.next;
+        station.cycle_count = 0;
+        station.cycles_required = cycles;
+        station.chain_cycle = opCycles(shape, instr.op);
+        if (station.tag == 0) {
+            station.executing = true;
+        }
+        status.rs = station.num;
+    }
+    else {
+        // adding to reservation station
+        reservation_station* stations = sim->add_reserv_stat;
+        int count = shape.addReservationStations();
+        int stall = STALL_ADD;
+        if (instr.op == OP_MULTD or instr.op == OP_DIVD or instr.op == OP_VMULTD or instr.op == OP_VDIVD) {
+            stations = sim->mul_reserv_stat;
+            count = shape.mulReservationStations();
+            stall = STALL_MUL;
+        }
+        int l = freeStation(stations, count);
+        if (l == -1) {
+            return stall;
+        }
+        reservation_station& station = stations[l];
+        // j and k registers are read before the destination is renamed
+        if (vector) {
+            readVector(sim, thread.rename_map, instr.reg_j, &station.src_j, &station.tag_j);
+            readVector(sim, thread.rename_map, instr.reg_k, &station.src_k, &station.tag_k);
+        }
+        else {
+            readOperand(sim, thread.rename_map, instr.reg_j, &station.data_j, &station.tag_j);
+            readOperand(sim, thread.rename_map, instr.reg_k, &station.data_k, &station.tag_k);
+        }
+        status.producer_j = producerInstr(sim, station.tag_j, shape);
+        status.producer_k = producerInstr(sim, station.tag_k, shape);
+        // destination register
+        station.dest_tag = renameRegister(sim, thread.rename_map, instr.dest, station.num, shape);
+
+        station.busy = true;
+        station.op = instr.op;
+        station.vl = instr.vl;
+        station.instr = thread.next;
+        station.cycle_count = 0;
+        station.cycles_required = cycles;
+        station.chain_cycle = opCycles(shape, instr.op);
+        if (station.tag_j == 0 and station.tag_k == 0) {
+            station.executing = true;
+        }
+        status.rs = station.num;
+    }
+    status.issue = sim->clockCycles+1;
+    // a stalled instruction issues as soon as a write frees what it was waiting for
+    status.stall = thread.stall;
+    thread.stall = STALL_NONE;
+    if (status.stall != STALL_NONE) {
+        status.freed = sim->written_instr;
+    }
+    return STALL_NONE;
+}
+
+// thread t issued this cycle, or - if t is -1 or the cycle's stall is set - nothing issued,
+// and the stall is counted
+void recordIssue(tomasulo* sim, int t)
+{
+    if (t != -1 and sim->stall == STALL_NONE) {
+        sim->issueSuccessful = true;
+        sim->issuingThread = t;
+        return;
+    }
+    if (t != -1) {
+        sim->threads[t].stall = sim->stall;
+    }
+    if (sim->stall == STALL_REGS) {
+        sim->renameStalls += 1;
+    }
+    else if (sim->stall != STALL_NONE) {
+        sim->stationStalls += 1;
+    }
+}
+
+// issue order of thread t this cycle, lowest first - no two threads have the same priority,
+// as the round robin position breaks ties
+int threadPriority(tomasulo* sim, int t)
+{
+    const int n = sim->numThreads;
+    const int position = (t - sim->clockCycles % n + n) % n;
+    if (sim->policy == FETCH_ICOUNT) {
+        const hardware_thread& thread = sim->threads[t];
+        return (thread.next - thread.begin - thread.written) * n + position;
+    }
+    return position;
+}
+
+// one instruction issues per cycle, from the first thread (in policy order) that can issue one -
+// if none can, the stall is charged to the first thread's resource
+template<typename S> void issueInstruction(tomasulo* sim, const S& shape)
+{
+    sim->stall = STALL_NONE;
+    // with one thread there is no order to work out
+    if (sim->numThreads == 1) {
+        if (sim->threads[0].next < sim->threads[0].end) {
+            sim->stall = issueFrom(sim, 0, shape);
+            recordIssue(sim, 0);
+        }
+        return;
+    }
+    int previous = -1;
+    for (int k=0; k < sim->numThreads; k++) {
+        int t = -1;
+        for (int i=0; i < sim->numThreads; i++) {
+            const int priority = threadPriority(sim, i);
+            if (priority > previous and (t == -1 or priority < threadPriority(sim, t))) {
+                t = i;
+            }
+        }
+        previous = threadPriority(sim, t);
+        if (sim->threads[t].next >= sim->threads[t].end) {
+            continue;
+        }
+        const int stall = issueFrom(sim, t, shape);
+        if (stall == STALL_NONE) {
+            sim->stall = STALL_NONE;
+            recordIssue(sim, t);
+            return;
+        }
+        sim->threads[t].stall = stall;
+        if (sim->stall == STALL_NONE) {
+            sim->stall = stall;
+        }
+    }
+    recordIssue(sim, -1);
+}
+
+// ================== COMPLETING AND EXECUTING INSTRUCTION CHECK ==================
+// just tracking completion cycle - simply for bookkeeping
+void markCompleted(tomasulo* sim, int instr)
+{
+    if (sim->status[instr].completion == -1) {
+        sim->status[instr].completion = sim->clockCycles;
+        sim->completedInstr += 1;
+    }
+}
+
+double applyOp(int op, double j, double k)
+{
+    if (op == OP_ADDD or op == OP_VADDD) {
+        return j + k;
+    }
+    else if (op == OP_SUBD or op == OP_VSUBD) {
+        return j - k;
+    }
+    else if (op == OP_MULTD or op == OP_VMULTD) {
+        return j * k;
+    }
+    return j / k;
+}
+
+// the station has read its vector source
+template<typename S> void releaseVector(tomasulo* sim, int p, const S& shape)
+{
+    sim->phys_registers[p].readers -= 1;
+    releaseRegister(sim, p, shape);
+}
+
+// vector results are computed straight into the destination register when the station gets the cdb,
+// nothing reads it before it is marked ready in writeResult
+template<typename S> void completeVector(tomasulo* sim, int op, int vl, int dest_tag, int src_j, int src_k, double load, const S& shape)
+{
+    double* dest = vectorElements(sim, dest_tag - 1, shape);
+    double* j = src_j == -1 ? NULL : vectorElements(sim, src_j, shape);
+    double* k = src_k == -1 ? NULL : vectorElements(sim, src_k, shape);
+    for (int e=0; e < shape.maxVectorLength(); e++) {
+        if (e >= vl) {
+            dest[e] = 0;
+        }
+        else if (op == OP_VLD) {
+            dest[e] = load;
+        }
+        else if (op == OP_VST) {
+            dest[e] = j[e];
+        }
+        else {
+            dest[e] = applyOp(op, j[e], k[e]);
+        }
+    }
+    if (src_j != -1) {
+        releaseVector(sim, src_j, shape);
+    }
+    if (src_k != -1) {
+        releaseVector(sim, src_k, shape);
+    }
+}
+
+// chaining is only worth a cdb cycle if some station is waiting for the vector
+template<typename S> bool hasWaiters(tomasulo* sim, int tag, const S& shape)
+{
+    for (int i=0; i < shape.addReservationStations() + shape.mulReservationStations(); i++) {
+        const reservation_station& station = sim->add_reserv_stat[i];
+        if ((station.tag_j == tag and !station.chained_j) or (station.tag_k == tag and !station.chained_k)) {
+            return true;
+        }
+    }
+    for (int i=0; i < shape.storeReservationStations(); i++) {
+        if (sim->store_reserv_stat[i].tag == tag and !sim->store_reserv_stat[i].chained) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<bool PRINT, typename S> void executeStations(tomasulo* sim, const S& shape)
+{
+    // ordered by increasing reservation station number
+    sim->cdb_busy = false;
+    const int arithRS = shape.addReservationStations() + shape.mulReservationStations();
+    for (int i=0; i < arithRS; i++) {
+        reservation_station& station = sim->add_reserv_stat[i];
+        // completing instructions
+        if (station.cycle_count == station.cycles_required) {
+            markCompleted(sim, station.instr);
+            if (!sim->cdb_busy) {
+                if (isVectorOp(station.op)) {
+                    completeVector(sim, station.op, station.vl, station.dest_tag, station.src_j, station.src_k, 0, shape);
+                    sim->cdb_data = 0;
+                }
+                else {
+                    sim->cdb_data = applyOp(station.op, station.data_j, station.data_k);
+                }
+                sim->cdb_busy = true;
+                sim->completed_rs = station.num;
+                sim->completed_instr = station.instr;
+                sim->completed_tag = station.dest_tag;
+            }
+        }
+        // chaining vector results
+        else if (station.busy and isVectorOp(station.op) and !station.chain_sent and station.cycle_count >= station.chain_cycle) {
+            if (!sim->cdb_busy and hasWaiters(sim, station.dest_tag, shape)) {
+                sim->cdb_busy = true;
+                sim->chain_tag = station.dest_tag;
+                station.chain_sent = true;
+            }
+        }
+        // executing instructions
+        if (station.busy and station.executing) {
+            // only increment if not yet reached, and a chained station can not finish before its sources are written
+            if (station.cycle_count + 1 < station.cycles_required or (station.cycle_count + 1 == station.cycles_required and station.tag_j == 0 and station.tag_k == 0)) {
+                station.cycle_count += 1;
+            }
+        }
+    }
+    for (int i=0; i < shape.loadReservationStations() + shape.storeReservationStations(); i++) {
+        bool store = i >= shape.loadReservationStations();
+        load_store_rs& station = store ? sim->store_reserv_stat[i - shape.loadReservationStations()] : sim->load_reserv_stat[i];
+        // completing instructions
+        if (station.cycle_count == station.cycles_required) {
+            markCompleted(sim, station.instr);
+            if (!sim->cdb_busy) {
+                if (isVectorOp(station.op)) {
+                    completeVector(sim, station.op, station.vl, station.dest_tag, station.src, -1, station.address, shape);
+                    sim->cdb_data = 0;
+                }
+                else {
+                    sim->cdb_data = station.address;
+                }
+                sim->cdb_busy = true;
+                sim->completed_rs = station.num;
+                sim->completed_instr = station.instr;
+                sim->completed_tag = station.dest_tag;
+            }
+        }
+        // chaining vector results
+        else if (station.busy and isVectorOp(station.op) and !station.chain_sent and station.cycle_count >= station.chain_cycle) {
+            if (!sim->cdb_busy and hasWaiters(sim, station.dest_tag, shape)) {
+                sim->cdb_busy = true;
+                sim->chain_tag = station.dest_tag;
+                station.chain_sent = true;
+            }
+        }
+        // executing instructions
+        if (station.busy and station.executing) {
+            if (PRINT and store) {
+                cout << "cycle count" << station.cycle_count << endl;
+                cout << "cycles required" << station.cycles_required << endl;
+            }
+            // only increment if not yet reached, and a chained store can not finish before its source is written
+            if (station.cycle_count + 1 < station.cycles_required or (station.cycle_count + 1 == station.cycles_required and station.tag == 0)) {
+                station.cycle_count += 1;
+            }
+        }
+    }
+}
+
+// ================== INCREMENT COUNTERS ==================
+void advanceClock(tomasulo* sim)
+{
+    if (sim->issueSuccessful) {
+        sim->issuedInstr += 1;
+        sim->threads[sim->issuingThread].next += 1;
+        sim->issueSuccessful = false;
+    }
+    sim->clockCycles += 1;
+}
+
+
+// ================== PRINTING TO CONSOLE ==================
+void printRegisterName(int reg, int numRegisters, const int& width)
+{
+    char name[MAXCHAR];
+    if (reg >= numRegisters) {
+        sprintf(name, "V%i", reg - numRegisters);
+    }
+    else {
+        sprintf(name, "R%i", reg*2);
+    }
+    printElement(name, width);
+}
+
+void printPhysicalName(int p, const int& width)
+{
+    char name[MAXCHAR];
+    sprintf(name, "P%i", p);
+    printElement(name, width);
+}
+
+// stations wait on physical registers, but are shown waiting on the station that produces them
+int producerStation(tomasulo* sim, int tag)
+{
+    if (tag == 0) {
+        return 0;
+    }
+    return sim->phys_registers[tag - 1].producer;
+}
+
+void printStations(tomasulo* sim, reservation_station* stations, int count)
+{
+    for (int i=0; i < count; i++) {
+        if (stations[i].cycles_required == -999) {
+            printElement("", 8);
+        }
+        else {
+            printElement(stations[i].cycles_required - stations[i].cycle_count, 8);
+        }
+        printElement("[", 0);
+        printElement(stations[i].num, 0);
+        printElement("]", 8);
+        if (stations[i].busy == 0) {
+            printElement(" ", 8);
+            printElement(" ", 8);
+            printElement(" ", 8);
+            printElement(" ", 8);
+        }
+        else {
+            printElement(stations[i].busy, 8);
+            printElement(opcode_names[stations[i].op], 8);
+            // vector operands are shown as the physical register they are read from
+            printElement(producerStation(sim, stations[i].tag_j), 8);
+            if (isVectorOp(stations[i].op)) {
+                printPhysicalName(stations[i].src_j, 8);
+            }
+            else printElement(stations[i].data_j, 8);
+            printElement(producerStation(sim, stations[i].tag_k), 8);
+            if (isVectorOp(stations[i].op)) {
+                printPhysicalName(stations[i].src_k, 8);
+            }
+            else printElement(stations[i].data_k, 8);
+        }
+        cout << endl;
+    }
+}
+
+void printStations(tomasulo*, load_store_rs* stations, int count)
+{
+    for (int i=0; i < count; i++) {
+        printElement("", 8);
+        printElement("[", 0);
+        printElement(stations[i].num, 0);
+        printElement("]", 8);
+        printElement(stations[i].busy, 10);
+        if (stations[i].busy == true) {
+            if (stations[i].op == OP_VST) {
+                printPhysicalName(stations[i].src, 0);
+            }
+            else printElement(stations[i].address, 0);
+        }
+        cout << endl;
+    }
+}
+
+void printCycle(tomasulo* sim)
+{
+    const machine_config* config = sim->config;
+    printInstructionStatus("test", 6);
+    for (int j=0; j < sim->lineCount; j++) {
+        if (sim->numThreads > 1 and j == sim->threads[threadOf(sim, j)].begin) {
+            cout << "Thread " << threadOf(sim, j) << ": " << sim->threads[threadOf(sim, j)].filename << endl;
+        }
+        const decoded_instruction& instr = sim->program[j];
+        const instruction_status& status = sim->status[j];
+        printElement(opcode_names[instr.op], 15);
+        if (instr.op == OP_LD or instr.op == OP_VLD) {
+            printElement(instr.load, 6);
+            printElement(" ", 8);
+        }
+        else {
+            printRegisterName(instr.reg_j, config->numRegisters, 7);
+            if (instr.reg_k == -1) {
+                printElement(" ", 7);
+            }
+            else printRegisterName(instr.reg_k, config->numRegisters, 7);
+        }
+        if (status.issue == -1) {
+            printElement(" ", 8);
+        }
+        else printElement(status.issue, 8);
+        if (status.completion == -1) {
+            printElement(" ", 12);
+        }
+        else printElement(status.completion, 12);
+        if (status.written == -1) {
+            printElement(" ", 0);
+        }
+        else printElement(status.written, 0);
+        cout << endl;
+    }
+    printStationStatus("test", 6);
+    printStations(sim, sim->add_reserv_stat, config->addReservationStations + config->mulReservationStations);
+    printLoadStatus("test", 6);
+    printStations(sim, sim->load_reserv_stat, config->loadReservationStations);
+    printStoreStatus("test", 6);
+    printStations(sim, sim->store_reserv_stat, config->storeReservationStations);
+    for (int t=0; t < sim->numThreads; t++) {
+        const int* rename_map = sim->threads[t].rename_map;
+        char label[MAXCHAR] = "";
+        if (sim->numThreads > 1) {
+            sprintf(label, " (thread %i)", t);
+        }
+        printRegisterStatus(label, config->numRegisters);
+        printElement(sim->clockCycles, 8);
+        for (int i=0; i < config->numRegisters; i++) {
+            const physical_register& reg = sim->phys_registers[rename_map[i]];
+            if (reg.ready) {
+                printElement(reg.data, 8);
+            }
+            else {
+                printElement("[", 0);
+                printElement(reg.producer, 0);
+                printElement("]", 8);
+            }
+        }
+        cout << endl;
+        printElement("Map", 8);
+        for (int i=0; i < config->numRegisters; i++) {
+            printElement("P", 0);
+            printElement(rename_map[i], 7);
+        }
+        cout << endl;
+        if (sim->hasVector) {
+            printVectorStatus("test", config->maxVectorLength);
+            for (int i=config->numRegisters; i < config->numRegisters + config->numVectorRegisters; i++) {
+                const int p = rename_map[i];
+                printRegisterName(i, config->numRegisters, 8);
+                printPhysicalName(p, 8);
+                if (sim->phys_registers[p].ready) {
+                    for (int e=0; e < config->maxVectorLength; e++) {
+                        printElement(vectorElements(sim, p)[e], 8);
+                    }
+                }
+                else {
+                    printElement("[", 0);
+                    printElement(sim->phys_registers[p].producer, 0);
+                    printElement("]", 8);
+                }
+                cout << endl;
+            }
+        }
+    }
+    printPhysicalStatus("test", 6);
+    printElement(sim->freeCount, 8);
+    printElement(sim->vectorFreeCount, 8);
+    printElement(sim->renameStalls, 0);
+    cout << endl << endl;
+}
+
+// instructions per cycle of each thread, up to the cycle its last instruction was written,
+// and of the whole run
+void printThreads(tomasulo* sim)
+{
+    printThreadStatus(fetch_policy_names[sim->policy], 8);
+    int cycles = 0;
+    for (int t=0; t < sim->numThreads; t++) {
+        const hardware_thread& thread = sim->threads[t];
+        const int instructions = thread.end - thread.begin;
+        printElement(t, 8);
+        printElement(instructions, 8);
+        printElement(thread.finish, 8);
+        printElement(thread.finish == 0 ? 0 : (double) instructions / thread.finish, 10);
+        printElement(thread.filename, 0);
+        cout << endl;
+        if (thread.finish > cycles) {
+            cycles = thread.finish;
+        }
+    }
+    printElement("All", 8);
+    printElement(sim->lineCount, 8);
+    printElement(cycles, 8);
+    printElement(cycles == 0 ? 0 : (double) sim->lineCount / cycles, 10);
+    cout << endl << endl;
+}
+
+// ================== CRITICAL PATH ==================
+// the critical path is rebuilt from the recorded cycles, walking back from the last write:
+// an instruction was written after it completed, completed after executing from its issue or
+// from the write of the producer it was waiting for, and issued after the instruction before it
+// in its thread, or - if a full station or free list held it up - after the write that freed one.
+// each instruction on the path is charged its own execution (fu latency) and wait for the cdb;
+// a producer's write is charged to the edge that led to it (dependence, station full, regs full),
+// as is the issue cycle after a write that freed a station. every cycle is charged once, so the
+// causes add up to the run time
+int stationClass(int op)
+{
+    switch (op) {
+        case OP_LD: case OP_VLD: return STALL_LOAD;
+        case OP_SD: case OP_VST: return STALL_STORE;
+        case OP_MULTD: case OP_DIVD: case OP_VMULTD: case OP_VDIVD: return STALL_MUL;
+        default: return STALL_ADD;
+    }
+}
+
+// charges the cycles after from, up to to, that have not been charged yet
+void chargeCycles(path_analysis* path, int from, int to, int cause, int instr, int resource)
+{
+    if (to > path->now) {
+        to = path->now;
+    }
+    if (from >= to) {
+        return;
+    }
+    path->cycles[instr * numPathCauses + cause] += to - from;
+    path->causes[cause] += to - from;
+    path->resources[resource] += to - from;
+    path->now = from;
+}
+
+// the producer whose result arrived last - producers are only recorded for operands that were
+// not ready at issue, so the instruction waited for each of them
+int lastProducer(tomasulo* sim, int instr)
+{
+    const instruction_status& status = sim->status[instr];
+    int producer = status.producer_j;
+    if (status.producer_k != -1) {
+        if (producer == -1 or sim->status[status.producer_k].written > sim->status[producer].written) {
+            producer = status.producer_k;
+        }
+    }
+    return producer;
+}
+
+void walkCriticalPath(tomasulo* sim, path_analysis* path, int instr)
+{
+    bool atIssue = false;
+    int edge = CAUSE_LATENCY;   // why the path came to this instruction's write
+    while (instr != -1) {
+        const instruction_status& status = sim->status[instr];
+        const int unit = stationClass(sim->program[instr].op);
+        if (!atIssue) {
+            chargeCycles(path, status.completion + 1, status.written, CAUSE_CDB, instr, RESOURCE_CDB);
+            chargeCycles(path, status.completion, status.completion + 1, edge, instr, edge == CAUSE_REGS ? STALL_REGS : unit);
+            const int producer = lastProducer(sim, instr);
+            if (producer != -1) {
+                // executing from the cycle the operand arrived - the producer accounts for the cycles before
+                chargeCycles(path, sim->status[producer].written, status.completion, CAUSE_LATENCY, instr, unit);
+                instr = producer;
+                edge = CAUSE_DEPENDENCE;
+                continue;
+            }
+            chargeCycles(path, status.issue, status.completion, CAUSE_LATENCY, instr, unit);
+        }
+        const int t = threadOf(sim, instr);
+        const int previous = instr > sim->threads[t].begin ? instr - 1 : -1;
+        const int previousIssue = previous == -1 ? 0 : sim->status[previous].issue;
+        const int stall = status.stall == STALL_REGS ? CAUSE_REGS : CAUSE_STATION;
+        atIssue = true;
+        if (status.stall != STALL_NONE and status.freed != -1 and sim->status[status.freed].issue < status.issue) {
+            // issued the cycle after the freeing write, which accounts for the cycles before
+            chargeCycles(path, sim->status[status.freed].written, status.issue, stall, status.freed, status.stall);
+            instr = status.freed;
+            edge = stall;
+            atIssue = false;
+        }
+        else if (status.stall != STALL_NONE) {
+            chargeCycles(path, previousIssue, status.issue, stall, instr, status.stall);
+            instr = previous;
+        }
+        else {
+            chargeCycles(path, previousIssue, status.issue, CAUSE_ISSUE, instr, 0);
+            instr = previous;
+        }
+    }
+}
+
+// the largest of n values not yet printed, which is then marked printed
+int nextLargest(const int* values, bool* printed, int n)
+{
+    int largest = -1;
+    for (int i=0; i < n; i++) {
+        if (!printed[i] and (largest == -1 or values[i] > values[largest])) {
+            largest = i;
+        }
+    }
+    if (largest != -1) {
+        printed[largest] = true;
+    }
+    return largest;
+}
+
+int instructionCycles(path_analysis* path, int i)
+{
+    int total = 0;
+    for (int c=0; c < numPathCauses; c++) {
+        total += path->cycles[i * numPathCauses + c];
+    }
+    return total;
+}
+
+// the instruction with the most cycles charged to it after the one printed before (ties in
+// program order), or -1 if no more have any
+int nextHottest(tomasulo* sim, path_analysis* path, int before)
+{
+    const int limit = before == -1 ? -1 : instructionCycles(path, before);
+    int hottest = -1;
+    int most = 0;
+    for (int i=0; i < sim->lineCount; i++) {
+        const int total = instructionCycles(path, i);
+        const bool after = limit == -1 or total < limit or (total == limit and i > before);
+        if (after and total > most) {
+            hottest = i;
+            most = total;
+        }
+    }
+    return hottest;
+}
+
+void printCriticalPath(tomasulo* sim, path_analysis* path, int cycles)
+{
+    bool printed[numResources] = {};
+    printCauseStatus(cycles, 14);
+    for (int k=0; k < numPathCauses; k++) {
+        const int c = nextLargest(path->causes, printed, numPathCauses);
+        if (path->causes[c] == 0) {
+            break;
+        }
+        printElement(path_cause_names[c], 14);
+        printElement(path->causes[c], 8);
+        printElement(100 * path->causes[c] / cycles, 0);
+        cout << "%" << endl;
+    }
+
+    memset(printed, 0, sizeof(printed));
+    printResourceStatus("test", 14);
+    for (int k=0; k < numResources; k++) {
+        const int r = nextLargest(path->resources, printed, numResources);
+        if (path->resources[r] == 0) {
+            break;
+        }
+        printElement(resource_names[r], 14);
+        printElement(path->resources[r], 8);
+        printElement(100 * path->resources[r] / cycles, 0);
+        cout << "%" << endl;
+    }
+
+    // instructions by the cycles charged to them, with the cause most of them went to -
+    // numbered within their thread when there is more than one
+    printHotStatus("test", 8);
+    int i = -1;
+    for (int k=0; k < MAX_HOT_INSTRUCTIONS; k++) {
+        i = nextHottest(sim, path, i);
+        if (i == -1) {
+            break;
+        }
+        const decoded_instruction& instr = sim->program[i];
+        // a tie goes to the cause that held the instruction up rather than to its issue slot
+        int cause = CAUSE_ISSUE;
+        for (int c=0; c < numPathCauses; c++) {
+            const int charged = path->cycles[i * numPathCauses + c];
+            const int most = path->cycles[i * numPathCauses + cause];
+            if (charged > most or (charged == most and cause == CAUSE_ISSUE and c != CAUSE_ISSUE)) {
+                cause = c;
+            }
+        }
+        if (sim->numThreads > 1) {
+            char name[MAXCHAR];
+            const int t = threadOf(sim, i);
+            sprintf(name, "T%i:%i", t, i - sim->threads[t].begin + 1);
+            printElement(name, 8);
+        }
+        else printElement(i + 1, 8);
+        printElement(opcode_names[instr.op], 8);
+        printRegisterName(instr.dest, sim->config->numRegisters, 6);
+        if (instr.op == OP_LD or instr.op == OP_VLD) {
+            printElement(instr.load, 6);
+        }
+        else printRegisterName(instr.reg_j, sim->config->numRegisters, 6);
+        if (instr.reg_k != -1) {
+            printRegisterName(instr.reg_k, sim->config->numRegisters, 6);
+        }
+        else printElement(" ", 6);
+        printElement(instructionCycles(path, i), 8);
+        printElement(path_cause_names[cause], 0);
+        cout << endl;
+    }
+    cout << endl;
+}
+
+// analyses a finished run - the per-instruction table was laid out in the arena with the run
+void analyzeRun(tomasulo* sim)
+{
+    if (sim->lineCount == 0) {
+        return;
+    }
+    int last = 0;
+    for (int i=1; i < sim->lineCount; i++) {
+        if (sim->status[i].written > sim->status[last].written) {
+            last = i;
+        }
+    }
+    const int cycles = sim->status[last].written;
+    path_analysis path;
+    path.cycles = sim->path_cycles;
+    memset(path.cycles, 0, sim->lineCount * numPathCauses * sizeof(int));
+    memset(path.causes, 0, sizeof(path.causes));
+    memset(path.resources, 0, sizeof(path.resources));
+    path.now = cycles;
+
+    walkCriticalPath(sim, &path, last);
+    printCriticalPath(sim, &path, cycles);
+}
+
+// ================== DEBUGGER ==================
+// the machine state lives in the arena from sim onwards, so a snapshot is a copy of those bytes,
+// restored to the same address (pointers inside it stay valid) - the instruction status comes
+// before it, as it would grow every snapshot with the length of the trace
+size_t snapshotStart(debugger* dbg)
+{
+    return (char*) dbg->sim - dbg->a->base;
+}
+
+void takeSnapshot(debugger* dbg)
+{
+    tomasulo* sim = dbg->sim;
+    if (sim->clockCycles % dbg->snapshotInterval != 0) {
+        return;
+    }
+    if (dbg->numSnapshots > 0 and dbg->snapshots[dbg->numSnapshots - 1].cycle >= sim->clockCycles) {
+        return;
+    }
+    // when full, keep every other snapshot and take them half as often
+    if (dbg->numSnapshots == MAX_SNAPSHOTS) {
+        int kept = 0;
+        for (int i=0; i < dbg->numSnapshots; i++) {
+            if (i % 2 == 0) {
+                dbg->snapshots[kept] = dbg->snapshots[i];
+                kept += 1;
+            }
+            else free(dbg->snapshots[i].bytes);
+        }
+        dbg->numSnapshots = kept;
+        dbg->snapshotInterval *= 2;
+        if (sim->clockCycles % dbg->snapshotInterval != 0) {
+            return;
+        }
+    }
+    size_t start = snapshotStart(dbg);
+    char* bytes = (char*) malloc(dbg->a->used - start);
+    if (bytes == NULL) {
+        // reversing just replays from an earlier snapshot
+        return;
+    }
+    memcpy(bytes, dbg->a->base + start, dbg->a->used - start);
+    dbg->snapshots[dbg->numSnapshots].cycle = sim->clockCycles;
+    dbg->snapshots[dbg->numSnapshots].bytes = bytes;
+    dbg->numSnapshots += 1;
+}
 
-typedef struct memory
+void freeSnapshots(debugger* dbg)
 {
-    char name[2];
-    double data;
-    int tag=0;
-    bool busy=false;
-} memory;
+    for (int i=0; i < dbg->numSnapshots; i++) {
+        free(dbg->snapshots[i].bytes);
+    }
+    dbg->numSnapshots = 0;
+}
 
-typedef struct reservation_station
+bool finished(tomasulo* sim)
 {
-    char name[100]="NONE";
-    double num;
-    double data_j=NULL;
-    double data_k=NULL;
-    double result;
-    int tag_j=0;
-    int tag_k=0;
-    int instr=-1;
-    int cycle_count=0;
-    int cycles_required=-999;
-    bool executing=false;
-    bool busy=false;
+    return sim->writtenInstr >= sim->lineCount;
+}
 
-} reservation_station;
+// clears what was recorded from the cycle on - every field is written once, in the cycle the
+// instruction issued, completed or was written (issue is recorded as the cycle after)
+void forgetStatus(tomasulo* sim, int cycle)
+{
+    for (int i=0; i < sim->lineCount; i++) {
+        instruction_status& status = sim->status[i];
+        if (status.issue > cycle) {
+            status = instruction_status();
+        }
+        if (status.completion >= cycle) {
+            status.completion = -1;
+        }
+        if (status.written >= cycle) {
+            status.written = -1;
+        }
+    }
+}
 
-typedef struct load_store_rs
+// restores the last snapshot at or before the cycle, then replays up to it - the simulation is
+// deterministic, so this is the state the run was in
+bool rewindTo(debugger* dbg, int cycle)
 {
-    char name[100]="NONE";
-    double num;
-    double address=NULL;
-    int instr=-1;
-    int tag=0;
-    int cycle_count=0;
-    int cycles_required=-999;
-    bool executing=false;
-    bool busy=false;
-} load_store_rs;
+    int i = dbg->numSnapshots - 1;
+    while (i >= 0 and dbg->snapshots[i].cycle > cycle) {
+        i -= 1;
+    }
+    if (i < 0) {
+        return false;
+    }
+    size_t start = snapshotStart(dbg);
+    memcpy(dbg->a->base + start, dbg->snapshots[i].bytes, dbg->a->used - start);
+    forgetStatus(dbg->sim, dbg->snapshots[i].cycle);
+    while (dbg->sim->clockCycles < cycle and !finished(dbg->sim)) {
+        stepCycle(dbg->sim);
+    }
+    return true;
+}
 
-void header(int n);
-template<typename T> void printElement(T t, const int& width);
-template<typename T> void printInstructionStatus(T t, const int& width);
-template<typename T> void printLoadStatus(T t, const int& width);
-template<typename T> void printStoreStatus(T t, const int& width);
-template<typename T> void printStationStatus(T t, const int& width);
-template<typename T> void printRegisterStatus(T t, const int& width);
+int hitBreakpoint(debugger* dbg)
+{
+    tomasulo* sim = dbg->sim;
+    for (int i=0; i < dbg->numBreakpoints; i++) {
+        const breakpoint& b = dbg->breakpoints[i];
+        if (b.kind == BREAK_CYCLE and sim->clockCycles == b.value) {
+            return i;
+        }
+        // issue is recorded as the cycle after the one it happened in, which is where the clock now is
+        if (b.kind == BREAK_ISSUE and sim->status[b.value - 1].issue == sim->clockCycles) {
+            return i;
+        }
+        if (b.kind == BREAK_FULL and sim->stall != STALL_NONE and (b.value == STALL_ANY or b.value == sim->stall)) {
+            return i;
+        }
+    }
+    return -1;
+}
 
-int main() {
-    // ==================== ASSUMPTIONS ====================
-    int addCycles = 2;
-    int subCycles = 2;
-    //int multCycles = 10;
-    int multCycles = 3;
-    int diviCycles = 40;
-    int loadCycles = 3;
-    int storeCycles = 3;
-    const int addReservationStations = 2;
-    const int mulReservationStations = 2;
-    const int loadReservationStations = 2;
-    const int storeReservationStations = 2;
-    const int maxInstructions = 16;
-    const int numRegisters = 6;
-    // add or delete entries depending on value of numRegisters
-    float dataRegisters[numRegisters] = {6, 3.5, 10, 0, 7.8, 2};
-    char* filename = "raw.txt";
-    //char* filename = "waw.txt";
-    //char* filename = "war.txt";
-    //char* filename = "sdld.txt";
-    //char* filename = "stall.txt";
-    //char* filename = "long.txt";
-    
-    // ==================== STRUCTURE INITIALIZATION ====================
-    instruction instruction_list[maxInstructions];
-    memory  data_registers[numRegisters];
-    
-    char rs_num[3];
-    for (int i=0; i < numRegisters; i++){
-        strcpy(data_registers[i].name, "R");
-        sprintf(rs_num, "%i", i*2);
-        strcat(data_registers[i].name, rs_num);
-        
-        data_registers[i].data = dataRegisters[i];
-    }
-    
-    reservation_station add_reserv_stat[addReservationStations];
-    reservation_station mul_reserv_stat[mulReservationStations];
-    
-    int j;
-    for (j=0; j < addReservationStations; j++) {
-        add_reserv_stat[j].num = j + 1;
-    }
-    
-    for (int k=0; k < mulReservationStations; k++) {
-        // each reservation station needs a unique number
-        mul_reserv_stat[k].num = j + k + 1;
-    }
-
-    load_store_rs load_reserv_stat[loadReservationStations];
-    load_store_rs store_reserv_stat[storeReservationStations];
-    
-    for (int i=0; i < loadReservationStations; i++) {
-        load_reserv_stat[i].num = addReservationStations + mulReservationStations + i + 1;
-    }
-    
-    for (int i=0; i < storeReservationStations; i++) {
-        store_reserv_stat[i].num = addReservationStations + mulReservationStations + loadReservationStations + i + 1;
-    }
-    
-    // ==================== VARIABLE INITIALIZATION ====================
-    int lineCount = 0;
-    int completedInstr = 0;
-    int issuedInstr = 0;
-    int writtenInstr = 0;
-    int clockCycles = 0;
-    int completed_rs = -1;
-    double cdb_data = 0;
-    bool issueSuccessful = false;
-    bool cdb_busy = false;
-    
-    // ==================== READ IN INSTRUCTIONS ====================
-    FILE *fp;
-    char mystring[MAXCHAR];
+void printBreakpoint(debugger* dbg, int i)
+{
+    const breakpoint& b = dbg->breakpoints[i];
+    cout << "Breakpoint " << i + 1 << ": ";
+    if (b.kind == BREAK_CYCLE) {
+        cout << "cycle " << b.value;
+    }
+    else if (b.kind == BREAK_ISSUE) {
+        cout << "issue of instruction " << b.value;
+    }
+    else {
+        cout << stall_names[b.value] << " full";
+    }
+    cout << endl;
+}
 
-    
-    fp = fopen(filename, "r");
-    if (fp == NULL){
-        printf("Could not open file %s",filename);
-        return 1;
+void printPosition(tomasulo* sim)
+{
+    if (finished(sim)) {
+        cout << "Finished after " << sim->clockCycles << " cycles" << endl;
+        return;
     }
-    while (fgets(mystring, MAXCHAR, fp) != NULL){
-        const char t[2] = "\t";
-        const char s[2] = " ";
-        char *token;
-        
-        token = strtok(mystring, t);
-        instruction_list[lineCount].num = atof(token);
-        strcpy(instruction_list[lineCount].type, strtok(token, s));
-        
-        token = strtok(NULL, s);
-        strcpy(instruction_list[lineCount].dest_reg, token);
-        
-        token = strtok(NULL, s);
-        if (strcmp(instruction_list[lineCount].type, "LD") == 0) {
-            instruction_list[lineCount].load = atoi(token);
+    cout << "Cycle " << sim->clockCycles << ": " << sim->issuedInstr << " issued, ";
+    cout << sim->writtenInstr << " of " << sim->lineCount << " written";
+    if (sim->stall != STALL_NONE) {
+        cout << ", issue held up by " << stall_names[sim->stall];
+    }
+    cout << endl;
+}
+
+// steps up to n cycles (no limit if n is negative), stopping early at a breakpoint
+void runCycles(debugger* dbg, long n)
+{
+    for (long i=0; (n < 0 or i < n) and !finished(dbg->sim); i++) {
+        stepCycle(dbg->sim);
+        takeSnapshot(dbg);
+        int hit = hitBreakpoint(dbg);
+        if (hit != -1) {
+            printBreakpoint(dbg, hit);
+            break;
         }
-        else {
-            strcpy(instruction_list[lineCount].reg_j, token);
+    }
+    printPosition(dbg->sim);
+}
+
+void printStationState(tomasulo* sim, int rs)
+{
+    const machine_config* config = sim->config;
+    const int arithRS = config->addReservationStations + config->mulReservationStations;
+    int remaining;
+    int tag_j;
+    int tag_k = 0;
+    bool executing;
+    if (rs <= arithRS) {
+        const reservation_station& station = sim->add_reserv_stat[rs - 1];
+        remaining = station.cycles_required - station.cycle_count;
+        tag_j = station.chained_j ? 0 : station.tag_j;
+        tag_k = station.chained_k ? 0 : station.tag_k;
+        executing = station.executing;
+    }
+    else {
+        const load_store_rs& station = rs <= arithRS + config->loadReservationStations
+            ? sim->load_reserv_stat[rs - arithRS - 1]
+            : sim->store_reserv_stat[rs - arithRS - config->loadReservationStations - 1];
+        remaining = station.cycles_required - station.cycle_count;
+        tag_j = station.chained ? 0 : station.tag;
+        executing = station.executing;
+    }
+    cout << "  in station [" << rs << "], ";
+    if (tag_j != 0 or tag_k != 0) {
+        cout << "waiting for";
+        if (tag_j != 0) {
+            cout << " [" << producerStation(sim, tag_j) << "]";
         }
-        
-        /* read in last part of instruction, if not load or store */
-        if (strcmp(instruction_list[lineCount].type, "LD") == 0 or strcmp(instruction_list[lineCount].type, "SD") == 0)
-        {
-            strcpy(instruction_list[lineCount].reg_k, " ");
+        if (tag_k != 0) {
+            cout << " [" << producerStation(sim, tag_k) << "]";
         }
-        else
-        {
-            token = strtok(NULL, s);
-            strcpy(instruction_list[lineCount].reg_k, token);
+    }
+    else if (remaining == 0) {
+        cout << "waiting for the cdb";
+    }
+    else if (executing) {
+        cout << remaining << " cycles left";
+    }
+    cout << endl;
+}
+
+void printInstruction(tomasulo* sim, int i)
+{
+    const decoded_instruction& instr = sim->program[i];
+    const instruction_status& status = sim->status[i];
+    const int numRegisters = sim->config->numRegisters;
+    cout << i + 1 << ": ";
+    printElement(opcode_names[instr.op], 8);
+    printRegisterName(instr.dest, numRegisters, 6);
+    if (instr.op == OP_LD or instr.op == OP_VLD) {
+        printElement(instr.load, 6);
+    }
+    else printRegisterName(instr.reg_j, numRegisters, 6);
+    if (instr.reg_k != -1) {
+        printRegisterName(instr.reg_k, numRegisters, 6);
+    }
+    if (isVectorOp(instr.op)) {
+        cout << "VL " << (int) instr.vl;
+    }
+    cout << endl;
+    if (status.issue == -1) {
+        cout << "  not issued";
+        if (i == sim->threads[threadOf(sim, i)].next and sim->stall != STALL_NONE) {
+            cout << ", held up by " << stall_names[sim->stall];
         }
+        cout << endl;
+        return;
+    }
+    cout << "  issue " << status.issue;
+    if (status.completion != -1) {
+        cout << ", completion " << status.completion;
+    }
+    if (status.written != -1) {
+        cout << ", written " << status.written;
+    }
+    cout << endl;
+    if (status.written == -1) {
+        printStationState(sim, status.rs);
+    }
+}
 
-        lineCount += 1;
+void printRegister(tomasulo* sim, int reg)
+{
+    const machine_config* config = sim->config;
+    const int p = sim->threads[0].rename_map[reg];
+    printRegisterName(reg, config->numRegisters, 0);
+    if (p == -1) {
+        cout << " is not used by this trace" << endl;
+        return;
     }
-    fclose(fp);
-    
-    // ==================== MAIN SIMULATION LOOP ====================
-    
-    while (writtenInstr < lineCount)
-    {
-        // ================== WRITING INSTRUCTIONS ==================
-        if (completed_rs != -1) {
-            // broadcast_data
-            for (int i=0; i < addReservationStations; i++) {
-                if (add_reserv_stat[i].tag_j == completed_rs) {
-                    add_reserv_stat[i].data_j = cdb_data;
-                    add_reserv_stat[i].tag_j = 0;
-                    if (add_reserv_stat[i].tag_j == 0 and add_reserv_stat[i].tag_k == 0) {
-                        add_reserv_stat[i].executing = true;
-                    }
-                }
-                if (add_reserv_stat[i].tag_k == completed_rs) {
-                    add_reserv_stat[i].data_k = cdb_data;
-                    add_reserv_stat[i].tag_k = 0;
-                    if (add_reserv_stat[i].tag_j == 0 and add_reserv_stat[i].tag_k == 0) {
-                        add_reserv_stat[i].executing = true;
-                    }
-                }
-                
-                // remove data from reservation station
-                if (add_reserv_stat[i].num == completed_rs) {
-                    add_reserv_stat[i].busy = false;
-                    add_reserv_stat[i].cycle_count = 0;
-                    add_reserv_stat[i].cycles_required = -999;
-                    add_reserv_stat[i].executing = false;
-                }
-            }
-            for (int i=0; i < mulReservationStations; i++) {
-                if (mul_reserv_stat[i].tag_j == completed_rs) {
-                    mul_reserv_stat[i].data_j = cdb_data;
-                    mul_reserv_stat[i].tag_j = 0;
-                    if (mul_reserv_stat[i].tag_j == 0 and mul_reserv_stat[i].tag_k == 0) {
-                        mul_reserv_stat[i].executing = true;
-                    }
-                }
-                if (mul_reserv_stat[i].tag_k == completed_rs) {
-                    mul_reserv_stat[i].data_k = cdb_data;
-                    mul_reserv_stat[i].tag_k = 0;
-                    if (mul_reserv_stat[i].tag_j == 0 and mul_reserv_stat[i].tag_k == 0) {
-                        mul_reserv_stat[i].executing = true;
-                    }
-                }
-                    
-                // clear reservation station
-                if (mul_reserv_stat[i].num == completed_rs) {
-                    mul_reserv_stat[i].busy = false;
-                    mul_reserv_stat[i].cycle_count = 0;
-                    mul_reserv_stat[i].cycles_required = -999;
-                    mul_reserv_stat[i].executing = false;
-                }
-            }
-            for (int i=0; i < loadReservationStations; i++) {
-                if (load_reserv_stat[i].tag == completed_rs) {
-                    load_reserv_stat[i].address = cdb_data;
-                    load_reserv_stat[i].tag = 0;
-                    load_reserv_stat[i].executing = true;
-                }
-                // clear reservation station
-                if (load_reserv_stat[i].num == completed_rs) {
-                    load_reserv_stat[i].busy = false;
-                    load_reserv_stat[i].cycle_count = 0;
-                    load_reserv_stat[i].cycles_required = -999;
-                    load_reserv_stat[i].executing = false;
-                }
-            }
-            for (int i=0; i < storeReservationStations; i++) {
-                if (store_reserv_stat[i].tag == completed_rs) {
-                    store_reserv_stat[i].address = cdb_data;
-                    store_reserv_stat[i].tag = 0;
-                    store_reserv_stat[i].executing = true;
-                }
-                // clear reservation station
-                if (store_reserv_stat[i].num == completed_rs) {
-                    store_reserv_stat[i].busy = false;
-                    store_reserv_stat[i].cycle_count = 0;
-                    store_reserv_stat[i].cycles_required = -999;
-                    store_reserv_stat[i].executing = false;
-                }
-            }
-            // write to memory
-            for (int i=0; i < numRegisters; i++) {
-                if (data_registers[i].tag == completed_rs) {
-                    data_registers[i].data = cdb_data;
-                    data_registers[i].busy = false;
-                    data_registers[i].tag = 0;
-                }
-            }
+    cout << " -> P" << p << ": ";
+    if (!sim->phys_registers[p].ready) {
+        cout << "waiting for [" << sim->phys_registers[p].producer << "]";
+    }
+    else if (reg >= config->numRegisters) {
+        for (int e=0; e < config->maxVectorLength; e++) {
+            cout << vectorElements(sim, p)[e] << " ";
+        }
+    }
+    else cout << sim->phys_registers[p].data;
+    cout << endl;
+}
 
-            // just for bookkeeping - instruction written cycle number
-            for (int j=0; j < issuedInstr; j++) {
-                if (instruction_list[j].rs == completed_rs) {
-                    if (instruction_list[j].written == -1) {
-                        instruction_list[j].written = clockCycles;
-                    }
-                }
-            }
+void printDebugHelp()
+{
+    cout << "run                      run until a breakpoint or the end" << endl;
+    cout << "step [n]                 run n cycles (default 1)" << endl;
+    cout << "back [n]                 go back n cycles (default 1)" << endl;
+    cout << "break cycle <n>          stop when cycle n is reached" << endl;
+    cout << "break issue <i>          stop when instruction i (numbered from 1) issues" << endl;
+    cout << "break full <resource>    stop when issue is held up by add, mul, load, store, regs or any" << endl;
+    cout << "delete [n]               delete breakpoint n, or all of them" << endl;
+    cout << "info                     show the position and breakpoints" << endl;
+    cout << "print                    print the full machine state" << endl;
+    cout << "print <i>                print instruction i" << endl;
+    cout << "print <register>         print a register, e.g. R2 or V1" << endl;
+    cout << "analyze                  show the critical path of the finished run" << endl;
+    cout << "quit" << endl;
+}
 
-            writtenInstr += 1;
-            // reset
-            completed_rs = -1;
-            cdb_data = 0;
-        }
-    
-        
-        // ================== ISSUING INSTRUCTIONS ==================
-        if (issuedInstr < lineCount) {
-            // issue instruction 0...then 1...then n..etc. (& increment instruction cycle if successful)
-            if (strcmp(instruction_list[issuedInstr].type, "ADDD") == 0 || strcmp(instruction_list[issuedInstr].type, "SUBD") == 0) {
-                // adding to reservation station
-                for (int l=0; l < addReservationStations; l++) {
-                    if (issueSuccessful == false) {
-                        if (add_reserv_stat[l].busy == false) {
-                            for (int i=0; i < numRegisters; i++) {
-                                // j register
-                                if (strcmp(instruction_list[issuedInstr].reg_j, data_registers[i].name) == 0) {
-                                    if (data_registers[i].tag == 0) {
-                                        add_reserv_stat[l].data_j = data_registers[i].data;
-                                    }
-                                    else {
-                                        add_reserv_stat[l].tag_j = data_registers[i].tag;
-                                    }
-                                }
-                                // k register
-                                if (strncmp(instruction_list[issuedInstr].reg_k, data_registers[i].name, 2) == 0) {
-                                    if (data_registers[i].tag == 0) {
-                                        add_reserv_stat[l].data_k = data_registers[i].data;
-                                    }
-                                    else {
-                                        add_reserv_stat[l].tag_k = data_registers[i].tag;
-                                    }
-                                }
-                                // destination register
-                                if (strcmp(instruction_list[issuedInstr].dest_reg, data_registers[i].name) == 0) {
-                                    data_registers[i].tag = add_reserv_stat[l].num;
-                                }
-                            }
-                            add_reserv_stat[l].busy = true;
-                            instruction_list[issuedInstr].rs = add_reserv_stat[l].num;
-                            add_reserv_stat[l].cycle_count = 0;
-                            instruction_list[issuedInstr].issue = clockCycles+1;
-                            issueSuccessful = true;
-                            if (add_reserv_stat[l].tag_j == 0 and add_reserv_stat[l].tag_k == 0) {
-                                add_reserv_stat[l].executing = true;
-                            }
-                            if (strcmp(instruction_list[issuedInstr].type, "ADDD") == 0) {
-                                strcpy(add_reserv_stat[l].name, "ADDD");
-                                add_reserv_stat[l].cycles_required = addCycles;
-                                
-                            }
-                            else {
-                                add_reserv_stat[l].cycles_required = subCycles;
-                                strcpy(add_reserv_stat[l].name, "SUBD");
-                            }
-                        }
-                    }
-                }
-            }
-            else if (strcmp(instruction_list[issuedInstr].type, "LD") == 0) {
-                for (int l=0; l < loadReservationStations; l++) {
-                    if (issueSuccessful == false) {
-                        if (load_reserv_stat[l].busy == false) {
-                            for (int i=0; i < numRegisters; i++) {
-                                // load value
-                                load_reserv_stat[l].address = instruction_list[issuedInstr].load;
-                                // destination register
-                                if (strncmp(instruction_list[issuedInstr].dest_reg, data_registers[i].name, 2) == 0) {
-                                    data_registers[i].tag = load_reserv_stat[l].num;
-                                }
-                            }
-                            load_reserv_stat[l].busy = true;
-                            load_reserv_stat[l].cycles_required = loadCycles;
-                            instruction_list[issuedInstr].rs = load_reserv_stat[l].num;
-                            load_reserv_stat[l].cycle_count = 0;
-                            instruction_list[issuedInstr].issue = clockCycles+1;
-                            issueSuccessful = true;
-                            load_reserv_stat[l].executing = true;
-                        }
-                    }
-                }
-            }
-            else if (strcmp(instruction_list[issuedInstr].type, "SD") == 0) {
-                for (int l=0; l < storeReservationStations; l++) {
-                    if (issueSuccessful == false) {
-                        if (store_reserv_stat[l].busy == false) {
-                            for (int i=0; i < numRegisters; i++) {
-                                if (strcmp(instruction_list[issuedInstr].dest_reg, data_registers[i].name) == 0) {
-                                    if (data_registers[i].tag == 0) {
-                                        store_reserv_stat[l].address = data_registers[i].data;
-                                    }
-                                    else {
-                                        store_reserv_stat[l].tag = data_registers[i].tag;
-                                    }
-                                }
-                                // destination register
-                                if (strncmp(instruction_list[issuedInstr].reg_j, data_registers[i].name, 2) == 0) {
-                                    data_registers[i].tag = store_reserv_stat[l].num;
-                                }
-                            }
-                            store_reserv_stat[l].busy = true;
-                            store_reserv_stat[l].cycles_required = storeCycles;
-                            instruction_list[issuedInstr].rs = store_reserv_stat[l].num;
-                            store_reserv_stat[l].cycle_count = 0;
-                            instruction_list[issuedInstr].issue = clockCycles+1;
-                            issueSuccessful = true;
-                            if (store_reserv_stat[l].tag == 0) {
-                                store_reserv_stat[l].executing = true;
-                            }
-                        }
-                    }
-                }
-            }
-            else {
-                // adding to reservation station
-                for (int l=0; l < mulReservationStations; l++) {
-                    if (issueSuccessful == false) {
-                        if (mul_reserv_stat[l].busy == false) {
-                            for (int i=0; i < numRegisters; i++) {
-                                // destination register
-                                if (strcmp(instruction_list[issuedInstr].dest_reg, data_registers[i].name) == 0) {
-                                    data_registers[i].tag = mul_reserv_stat[l].num;
-                                }
-                                // j register
-                                if (strcmp(instruction_list[issuedInstr].reg_j, data_registers[i].name) == 0) {
-                                    if (data_registers[i].tag == 0) {
-                                        mul_reserv_stat[l].data_j = data_registers[i].data;
-                                    }
-                                    else {
-                                        mul_reserv_stat[l].tag_j = data_registers[i].tag;
-                                    }
-                                }
-                                // k register
-                                if (strncmp(instruction_list[issuedInstr].reg_k, data_registers[i].name, 2) == 0) {
-                                    if (data_registers[i].tag == 0) {
-                                        mul_reserv_stat[l].data_k = data_registers[i].data;
-                                    }
-                                    else {
-                                        mul_reserv_stat[l].tag_k = data_registers[i].tag;
-                                    }
-                                }
-                            }
-                            mul_reserv_stat[l].busy = true;
-                            instruction_list[issuedInstr].rs = mul_reserv_stat[l].num;
-                            mul_reserv_stat[l].cycle_count = 0;
-                            instruction_list[issuedInstr].issue = clockCycles+1;
-                            issueSuccessful = true;
-                            if (mul_reserv_stat[l].tag_j == 0 and mul_reserv_stat[l].tag_k == 0) {
-                                mul_reserv_stat[l].executing = true;
-                            }
-                            if (strcmp(instruction_list[issuedInstr].type, "MULTD") == 0) {
-                                strcpy(mul_reserv_stat[l].name, "MULTD");
-                                mul_reserv_stat[l].cycles_required = multCycles;
-                                
-                            }
-                            else {
-                                mul_reserv_stat[l].cycles_required = diviCycles;
-                                strcpy(mul_reserv_stat[l].name, "DIVD");
-                            }
-                        }
-                    }
-                }
-            }
-            
-        }
-
-        
-        // ================== COMPLETING AND EXECUTING INSTRUCTION CHECK ==================
-        // ordered by increasing reservation station number
-        cdb_busy = false;
-        for (int i=0; i < addReservationStations; i++){
-            // completing instructions
-            if (add_reserv_stat[i].cycle_count == add_reserv_stat[i].cycles_required) {
-                for (int j=0; j < issuedInstr; j++) {
-                    // just tracking completion cycle - simply for bookkeeping
-                    if (instruction_list[j].rs == add_reserv_stat[i].num) {
-                        if (instruction_list[j].completion == -1) {
-                            instruction_list[j].completion = clockCycles;
-                            completedInstr += 1;
-                        }
-                    }
-                }
-                if (!cdb_busy) {
-                    if (strcmp(add_reserv_stat[i].name, "ADDD") == 0) {
-                        cdb_data = add_reserv_stat[i].data_j + add_reserv_stat[i].data_k;
-                    }
-                    else {
-                        cdb_data = add_reserv_stat[i].data_j - add_reserv_stat[i].data_k;
-                    }
-                    cdb_busy = true;
-                    completed_rs = add_reserv_stat[i].num;
-                }
-            }
-            // executing instructions
-            if (add_reserv_stat[i].busy and add_reserv_stat[i].executing) {
-                if (add_reserv_stat[i].cycle_count < add_reserv_stat[i].cycles_required) {
-                    add_reserv_stat[i].cycle_count += 1;
-                }
-            }
+// returns the count or number in text, or -1 if it is missing, not a number or less than 1
+long parseCount(const char* text)
+{
+    char* end;
+    long n = strtol(text, &end, 10);
+    if (end == text or *end != '\0' or n < 1) {
+        return -1;
+    }
+    return n;
+}
+
+void addBreakpoint(debugger* dbg, const char* kind, const char* value)
+{
+    tomasulo* sim = dbg->sim;
+    if (dbg->numBreakpoints == MAX_BREAKPOINTS) {
+        cout << "Too many breakpoints" << endl;
+        return;
+    }
+    breakpoint b;
+    b.value = -1;
+    if (strcmp(kind, "cycle") == 0) {
+        b.kind = BREAK_CYCLE;
+        b.value = parseCount(value);
+        if (b.value == -1) {
+            cout << "Invalid cycle " << value << endl;
+            return;
         }
-        for (int i=0; i < mulReservationStations; i++) {
-            // completing instructions
-            if (mul_reserv_stat[i].cycle_count == mul_reserv_stat[i].cycles_required) {
-                for (int j=0; j < issuedInstr; j++) {
-                    // just tracking completion cycle - simply for bookkeeping
-                    if (instruction_list[j].rs == mul_reserv_stat[i].num) {
-                        if (instruction_list[j].completion == -1) {
-                            instruction_list[j].completion = clockCycles;
-                            completedInstr += 1;
-                        }
-                    }
-                }
-                if (!cdb_busy) {
-                    if (strcmp(mul_reserv_stat[i].name, "MULTD") == 0) {
-                        cdb_data = mul_reserv_stat[i].data_j * mul_reserv_stat[i].data_k;
-                    }
-                    else {
-                        cdb_data = mul_reserv_stat[i].data_j / mul_reserv_stat[i].data_k;
-                    }
-                    cdb_busy = true;
-                    completed_rs = mul_reserv_stat[i].num;
-                }
-            }
-            // executing instructions
-            if (mul_reserv_stat[i].busy and mul_reserv_stat[i].executing) {
-                // only increment if not yet reached
-                if (mul_reserv_stat[i].cycle_count < mul_reserv_stat[i].cycles_required) {
-                    mul_reserv_stat[i].cycle_count += 1;
-                }
-            }
+    }
+    else if (strcmp(kind, "issue") == 0) {
+        b.kind = BREAK_ISSUE;
+        b.value = parseCount(value);
+        if (b.value < 1 or b.value > sim->lineCount) {
+            cout << "No instruction " << value << endl;
+            return;
         }
-        for (int i=0; i < loadReservationStations; i++) {
-            // completing instructions
-            if (load_reserv_stat[i].cycle_count == load_reserv_stat[i].cycles_required) {
-                for (int j=0; j < issuedInstr; j++) {
-                    // just tracking completion cycle - simply for bookkeeping
-                    if (instruction_list[j].rs == load_reserv_stat[i].num) {
-                        if (instruction_list[j].completion == -1) {
-                            instruction_list[j].completion = clockCycles;
-                            completedInstr += 1;
-                        }
-                    }
-                }
-                if (!cdb_busy) {
-                    cdb_data = load_reserv_stat[i].address;
-                    cdb_busy = true;
-                    completed_rs = load_reserv_stat[i].num;
-                }
-            }
-            // executing instructions
-            if (load_reserv_stat[i].busy and load_reserv_stat[i].executing) {
-                // only increment if not yet reached
-                if (load_reserv_stat[i].cycle_count < load_reserv_stat[i].cycles_required) {
-                    load_reserv_stat[i].cycle_count += 1;
-                }
+    }
+    else if (strcmp(kind, "full") == 0) {
+        b.kind = BREAK_FULL;
+        for (int i=1; i < numStallClasses; i++) {
+            if (strcmp(value, stall_names[i]) == 0) {
+                b.value = i;
             }
         }
-        for (int i=0; i < storeReservationStations; i++) {
-            // completing instructions
-            if (store_reserv_stat[i].cycle_count == store_reserv_stat[i].cycles_required) {
-                for (int j=0; j < issuedInstr; j++) {
-                    // just tracking completion cycle - simply for bookkeeping
-                    if (instruction_list[j].rs == store_reserv_stat[i].num) {
-                        if (instruction_list[j].completion == -1) {
-                            instruction_list[j].completion = clockCycles;
-                            completedInstr += 1;
-                        }
-                    }
-                }
-                if (!cdb_busy) {
-                    cdb_data = store_reserv_stat[i].address;
-                    cdb_busy = true;
-                    completed_rs = store_reserv_stat[i].num;
-                }
-            }
-            // executing instructions
-            if (store_reserv_stat[i].busy and store_reserv_stat[i].executing) {
-                cout << "cycle count" << store_reserv_stat[i].cycle_count << endl;
-                cout << "cycles required" << store_reserv_stat[i].cycles_required << endl;
-                // only increment if not yet reached
-                if (store_reserv_stat[i].cycle_count < store_reserv_stat[i].cycles_required) {
-                    store_reserv_stat[i].cycle_count += 1;
-                }
-            }
+        if (b.value == -1) {
+            cout << "Unknown resource " << value << endl;
+            return;
         }
-    
-        // ================== PRINTING TO CONSOLE ==================
-        printInstructionStatus("test", 6);
-        for (int j=0; j < lineCount; j++) {
-            printElement(instruction_list[j].type, 15);
-            if (strcmp(instruction_list[j].type, "LD") == 0) {
-                printElement(instruction_list[j].load, 6);
-                printElement(" ", 8);
-            }
-            else {
-                printElement(instruction_list[j].reg_j[0], 0);
-                printElement(instruction_list[j].reg_j[1], 6);
-                printElement(instruction_list[j].reg_k[0], 0);
-                printElement(instruction_list[j].reg_k[1], 6);
-            }
-            if (instruction_list[j].issue == -1) {
-                printElement(" ", 8);
-            }
-            else printElement(instruction_list[j].issue, 8);
-            if (instruction_list[j].completion == -1) {
-                printElement(" ", 12);
-            }
-            else printElement(instruction_list[j].completion, 12);
-            if (instruction_list[j].written == -1) {
-                printElement(" ", 0);
-            }
-            else printElement(instruction_list[j].written, 0);
-            cout << endl;
+    }
+    else {
+        cout << "Unknown breakpoint " << kind << endl;
+        return;
+    }
+    dbg->breakpoints[dbg->numBreakpoints] = b;
+    dbg->numBreakpoints += 1;
+    printBreakpoint(dbg, dbg->numBreakpoints - 1);
+}
+
+void deleteBreakpoint(debugger* dbg, const char* value)
+{
+    if (value[0] == '\0') {
+        dbg->numBreakpoints = 0;
+        return;
+    }
+    long n = parseCount(value);
+    if (n < 1 or n > dbg->numBreakpoints) {
+        cout << "No breakpoint " << value << endl;
+        return;
+    }
+    for (int i=n; i < dbg->numBreakpoints; i++) {
+        dbg->breakpoints[i - 1] = dbg->breakpoints[i];
+    }
+    dbg->numBreakpoints -= 1;
+}
+
+int debug(const char* filename, const machine_config* config, arena* a)
+{
+    arenaReset(a);
+    tomasulo* sim = loadSimulator(&filename, 1, config, a, true);
+    if (sim == NULL) {
+        return 1;
+    }
+    debugger dbg;
+    dbg.a = a;
+    dbg.sim = sim;
+    takeSnapshot(&dbg);
+
+    cout << "Debugging " << filename << ", " << sim->lineCount << " instructions (type help for commands)" << endl;
+    char line[MAXCHAR];
+    while (true) {
+        cout << "(tomasulo) " << flush;
+        if (fgets(line, MAXCHAR, stdin) == NULL) {
+            break;
         }
-        printStationStatus("test", 6);
-        for (int i=0; i < addReservationStations; i++) {
-            if (add_reserv_stat[i].cycles_required == -999) {
-                printElement("", 8);
-            }
-            else {
-                printElement(add_reserv_stat[i].cycles_required - add_reserv_stat[i].cycle_count, 8);
-            }
-            printElement("[", 0);
-            printElement(add_reserv_stat[i].num, 0);
-            printElement("]", 8);
-            if (add_reserv_stat[i].busy == 0) {
-                printElement(" ", 8);
-                printElement(" ", 8);
-                printElement(" ", 8);
-                printElement(" ", 8);
-            }
-            else {
-                printElement(add_reserv_stat[i].busy, 8);
-                printElement(add_reserv_stat[i].name, 8);
-                printElement(add_reserv_stat[i].tag_j, 8);
-                printElement(add_reserv_stat[i].data_j, 8);
-                printElement(add_reserv_stat[i].tag_k, 8);
-                printElement(add_reserv_stat[i].data_k, 8);
-            }
-            cout << endl;
+        char command[MAXCHAR] = "";
+        char arg[MAXCHAR] = "";
+        char value[MAXCHAR] = "";
+        sscanf(line, "%s %s %s", command, arg, value);
+        long n = arg[0] == '\0' ? 1 : parseCount(arg);
+
+        if (command[0] == '\0') {
+            continue;
+        }
+        else if (strcmp(command, "quit") == 0 or strcmp(command, "q") == 0) {
+            break;
+        }
+        else if (strcmp(command, "run") == 0 or strcmp(command, "r") == 0) {
+            runCycles(&dbg, -1);
         }
-        for (int i=0; i < mulReservationStations; i++) {
-            if (mul_reserv_stat[i].cycles_required == -999) {
-                printElement("", 8);
+        else if ((strcmp(command, "step") == 0 or strcmp(command, "s") == 0
+                or strcmp(command, "back") == 0 or strcmp(command, "b") == 0) and n == -1) {
+            cout << "Invalid count " << arg << endl;
+        }
+        else if (strcmp(command, "step") == 0 or strcmp(command, "s") == 0) {
+            runCycles(&dbg, n);
+        }
+        else if (strcmp(command, "back") == 0 or strcmp(command, "b") == 0) {
+            int target = sim->clockCycles - n < 0 ? 0 : sim->clockCycles - n;
+            if (!rewindTo(&dbg, target)) {
+                cout << "No snapshot to go back to" << endl;
             }
-            else {
-                printElement(mul_reserv_stat[i].cycles_required - mul_reserv_stat[i].cycle_count, 8);
+            printPosition(sim);
+        }
+        else if (strcmp(command, "break") == 0) {
+            addBreakpoint(&dbg, arg, value);
+        }
+        else if (strcmp(command, "delete") == 0) {
+            deleteBreakpoint(&dbg, arg);
+        }
+        else if (strcmp(command, "info") == 0) {
+            printPosition(sim);
+            cout << "Rename stalls: " << sim->renameStalls << ", station stalls: " << sim->stationStalls << endl;
+            for (int i=0; i < dbg.numBreakpoints; i++) {
+                printBreakpoint(&dbg, i);
             }
-            printElement("[", 0);
-            printElement(mul_reserv_stat[i].num, 0);
-            printElement("]", 8);
-            if (mul_reserv_stat[i].busy == 0) {
-                printElement(" ", 8);
-                printElement(" ", 8);
-                printElement(" ", 8);
-                printElement(" ", 8);
+        }
+        else if (strcmp(command, "print") == 0 or strcmp(command, "p") == 0) {
+            int reg = registerIndex(arg, config->numRegisters);
+            if (reg == -1) {
+                reg = vectorRegisterIndex(arg, config);
             }
-            else {
-                printElement(mul_reserv_stat[i].busy, 8);
-                printElement(mul_reserv_stat[i].name, 8);
-                printElement(mul_reserv_stat[i].tag_j, 8);
-                printElement(mul_reserv_stat[i].data_j, 8);
-                printElement(mul_reserv_stat[i].tag_k, 8);
-                printElement(mul_reserv_stat[i].data_k, 8);
+            if (arg[0] == '\0') {
+                printCycle(sim);
             }
-            cout << endl;
-        }
-        printLoadStatus("test", 6);
-        for (int i=0; i < loadReservationStations; i++) {
-            printElement("", 8);
-            printElement("[", 0);
-            printElement(load_reserv_stat[i].num, 0);
-            printElement("]", 8);
-            printElement(load_reserv_stat[i].busy, 10);
-            if (load_reserv_stat[i].busy == true) {
-                printElement(load_reserv_stat[i].address, 0);
+            else if (reg != -1) {
+                printRegister(sim, reg);
             }
-            cout << endl;
-        }
-        printStoreStatus("test", 6);
-        for (int i=0; i < storeReservationStations; i++) {
-            printElement("", 8);
-            printElement("[", 0);
-            printElement(store_reserv_stat[i].num, 0);
-            printElement("]", 8);
-            printElement(store_reserv_stat[i].busy, 10);
-            if (store_reserv_stat[i].busy == true) {
-                printElement(store_reserv_stat[i].address, 0);
+            else if (n >= 1 and n <= sim->lineCount) {
+                printInstruction(sim, n - 1);
             }
-            cout << endl;
+            else cout << "Nothing to print for " << arg << endl;
         }
-        printRegisterStatus("test", 6);
-        printElement(clockCycles, 8);
-        for (int i=0; i < numRegisters; i++) {
-            if (data_registers[i].tag == 0) {
-                printElement(data_registers[i].data, 8);
-            }
-            else {
-                printElement("[", 0);
-                printElement(data_registers[i].tag, 0);
-                printElement("]", 8);
+        else if (strcmp(command, "analyze") == 0 or strcmp(command, "a") == 0) {
+            if (finished(sim)) {
+                analyzeRun(sim);
             }
+            else cout << "The run has not finished" << endl;
         }
-        cout << endl << endl;
-        
-        // ================== INCREMENT COUNTERS ==================
-        if (issueSuccessful) {
-            issuedInstr += 1;
-            issueSuccessful = false;
+        else if (strcmp(command, "help") == 0 or strcmp(command, "h") == 0) {
+            printDebugHelp();
         }
-        clockCycles += 1;
+        else cout << "Unknown command " << command << " (type help for commands)" << endl;
     }
-    
+
+    freeSnapshots(&dbg);
     return 0;
 }
 
@@ -792,16 +2611,72 @@ template<typename T> void printStationStatus(T t, const int& width)
     cout << endl;
 }
 
-template<typename T> void printRegisterStatus(T t, const int& width)
+// t names the thread, if there is more than one (otherwise it is empty)
+template<typename T> void printRegisterStatus(T t, const int& numRegisters)
 {
-    cout << endl << "Register Result Status:" << endl;
+    cout << endl << "Register Result Status" << t << ":" << endl;
     printElement("Clock", 8);
-    printElement("R0", 8);
-    printElement("R2", 8);
-    printElement("R4", 8);
-    printElement("R6", 8);
-    printElement("R8", 8);
-    printElement("R10", 8);
+    for (int i=0; i < numRegisters; i++) {
+        printRegisterName(i, numRegisters, 8);
+    }
+    cout << endl;
+}
+
+template<typename T> void printVectorStatus(T t, const int& maxVectorLength)
+{
+    cout << endl << "Vector Registers:" << endl;
+    printElement("Name", 8);
+    printElement("Map", 8);
+    for (int e=0; e < maxVectorLength; e++) {
+        printElement(e, 8);
+    }
+    cout << endl;
+}
+
+template<typename T> void printPhysicalStatus(T t, const int& width)
+{
+    cout << endl << "Physical Registers:" << endl;
+    printElement("Free", 8);
+    printElement("VFree", 8);
+    printElement("Stalls", 0);
+    cout << endl;
+}
+
+template<typename T> void printThreadStatus(T t, const int& width)
+{
+    cout << "Threads (" << t << "):" << endl;
+    printElement("Thread", width);
+    printElement("Instr", 8);
+    printElement("Cycles", 8);
+    printElement("IPC", 10);
+    printElement("Trace", 0);
+    cout << endl;
+}
+
+template<typename T> void printCauseStatus(T t, const int& width)
+{
+    cout << "Critical Path (" << t << " cycles):" << endl;
+    printElement("Cause", width);
+    printElement("Cycles", 8);
+    printElement("Share", 0);
+    cout << endl;
+}
+
+template<typename T> void printResourceStatus(T t, const int& width)
+{
+    cout << endl << "Resources:" << endl;
+    printElement("Resource", width);
+    printElement("Cycles", 8);
+    printElement("Share", 0);
+    cout << endl;
+}
+
+template<typename T> void printHotStatus(T t, const int& width)
+{
+    cout << endl << "Hot Instructions:" << endl;
+    printElement("Instr", width);
+    printElement("Instruction", 26);
+    printElement("Cycles", 8);
+    printElement("Cause", 0);
     cout << endl;
 }
-    